@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include "computer.h"
+#include "batch.h"
+
+unsigned int endianSwap(unsigned int);
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+/* One register (or memory word) across all lanes */
+typedef __m256i Lanes;
+
+#define LOAD(p)		_mm256_loadu_si256 ((const __m256i*)(p))
+#define STORE(p,m,v)	_mm256_maskstore_epi32 ((p), (m), (v))
+#define SPLAT(x)	_mm256_set1_epi32 (x)
+#define ADD(a,b)	_mm256_add_epi32 ((a), (b))
+#define SUB(a,b)	_mm256_sub_epi32 ((a), (b))
+#define AND(a,b)	_mm256_and_si256 ((a), (b))
+#define OR(a,b)		_mm256_or_si256 ((a), (b))
+#define CMPEQ(a,b)	_mm256_cmpeq_epi32 ((a), (b))
+#define CMPLT(a,b)	_mm256_cmpgt_epi32 ((b), (a))
+#define SLL(a,n)	_mm256_sll_epi32 ((a), _mm_cvtsi32_si128 (n))
+#define SRL(a,n)	_mm256_srl_epi32 ((a), _mm_cvtsi32_si128 (n))
+/* lanes of b where m is set, lanes of a elsewhere */
+#define BLEND(a,b,m)	_mm256_blendv_epi8 ((a), (b), (m))
+
+#else
+
+/* Portable fallback with the same semantics, one lane at a time */
+typedef struct { int v [BATCH_LANES]; } Lanes;
+
+#define LANEWISE(expr) { Lanes r; int l; \
+    for (l=0; l<BATCH_LANES; l++) { r.v[l] = (expr); } return r; }
+
+static Lanes LOAD (const int* p) LANEWISE (p[l])
+static Lanes SPLAT (int x) LANEWISE (x)
+static Lanes ADD (Lanes a, Lanes b) LANEWISE (a.v[l] + b.v[l])
+static Lanes SUB (Lanes a, Lanes b) LANEWISE (a.v[l] - b.v[l])
+static Lanes AND (Lanes a, Lanes b) LANEWISE (a.v[l] & b.v[l])
+static Lanes OR (Lanes a, Lanes b) LANEWISE (a.v[l] | b.v[l])
+static Lanes CMPEQ (Lanes a, Lanes b) LANEWISE (a.v[l] == b.v[l] ? -1 : 0)
+static Lanes CMPLT (Lanes a, Lanes b) LANEWISE (a.v[l] < b.v[l] ? -1 : 0)
+static Lanes SLL (Lanes a, int n) LANEWISE ((unsigned int)a.v[l] << n)
+static Lanes SRL (Lanes a, int n) LANEWISE ((unsigned int)a.v[l] >> n)
+static Lanes BLEND (Lanes a, Lanes b, Lanes m) LANEWISE (m.v[l] ? b.v[l] : a.v[l])
+
+static void STORE (int* p, Lanes m, Lanes v) {
+    int l;
+    for (l=0; l<BATCH_LANES; l++) {
+        if (m.v[l]) {
+            p[l] = v.v[l];
+        }
+    }
+}
+
+#endif
+
+#define REG(r) LOAD (b->registers[r])
+
+/*
+ *  Load the program from filein into every lane, with the stack pointer
+ *  and remaining registers initialized as in InitComputer().
+ *  Returns 0 on success, -1 if the program is too big.
+ */
+int BatchInit (BatchComputer* b, FILE* filein) {
+    unsigned int instr;
+    int k, l;
+
+    memset (b, 0, sizeof (BatchComputer));
+    for (l=0; l<BATCH_LANES; l++) {
+        b->registers[29][l] = 0x00400000 + (MAXNUMINSTRS+MAXNUMDATA)*4;
+        b->pc[l] = 0x00400000;
+        b->status[l] = BATCH_RUNNING;
+    }
+
+    k = 0;
+    while (fread (&instr, 4, 1, filein)) {
+        if (k >= MAXNUMINSTRS) {
+            return -1;
+        }
+        for (l=0; l<BATCH_LANES; l++) {
+            b->memory[k][l] = ntohl (endianSwap (instr));
+        }
+        k++;
+    }
+    return 0;
+}
+
+void BatchSetRegister (BatchComputer* b, int lane, int reg, int value) {
+    if (reg != 0) {
+        b->registers[reg][lane] = value;
+    }
+}
+
+/* Stop every lane in mask with the given status */
+static void BatchStop (BatchComputer* b, int* mask, LaneStatus status) {
+    int l;
+    for (l=0; l<BATCH_LANES; l++) {
+        if (mask[l]) {
+            b->status[l] = status;
+            mask[l] = 0;
+        }
+    }
+}
+
+/*
+ *  Check the per-lane effective addresses of a lw or sw, faulting the
+ *  lanes that fall outside memory. Returns the memory word index of each
+ *  lane in index[].
+ */
+static void BatchAddresses (BatchComputer* b, Lanes addr, int* mask, int* index) {
+    int a [BATCH_LANES];
+    int l;
+
+    STORE (a, SPLAT (-1), addr);
+    for (l=0; l<BATCH_LANES; l++) {
+        if (!mask[l]) {
+            continue;
+        }
+        if ((a[l] & 3) != 0 || a[l] < 0x00400000
+            || a[l] >= 0x00400000 + 4*(MAXNUMINSTRS+MAXNUMDATA)) {
+            b->status[l] = BATCH_FAULT;
+            mask[l] = 0;
+        } else {
+            index[l] = (a[l] - 0x00400000)/4;
+        }
+    }
+}
+
+/* Execute instr for the lanes set in mask */
+static void BatchExecute (BatchComputer* b, unsigned int instr, int* mask) {
+    int op = instr >> 26;
+    int rs = (instr >> 21) & 0x1f;
+    int rt = (instr >> 16) & 0x1f;
+    int rd = (instr >> 11) & 0x1f;
+    int shamt = (instr >> 6) & 0x1f;
+    int funct = instr & 0x3f;
+    int simm = (short) (instr & 0xffff);
+    unsigned int uimm = instr & 0xffff;
+    int target = (instr & 0x03ffffff) << 2;
+    int index [BATCH_LANES], loaded [BATCH_LANES];
+    int dest = -1, l;
+    Lanes m, next, val = SPLAT (0);
+
+    next = ADD (LOAD (b->pc), SPLAT (4));
+
+    switch (op) {
+    case 0x0:
+        switch (funct) {
+        case 0x21: /* addu */
+            val = ADD (REG (rs), REG (rt));
+            dest = rd;
+            break;
+        case 0x24: /* and */
+            val = AND (REG (rs), REG (rt));
+            dest = rd;
+            break;
+        case 0x08: /* jr */
+            next = REG (rs);
+            break;
+        case 0x25: /* or */
+            val = OR (REG (rs), REG (rt));
+            dest = rd;
+            break;
+        case 0x2a: /* slt */
+            val = SRL (CMPLT (REG (rs), REG (rt)), 31);
+            dest = rd;
+            break;
+        case 0x00: /* sll */
+            val = SLL (REG (rt), shamt);
+            dest = rd;
+            break;
+        case 0x02: /* srl */
+            val = SRL (REG (rt), shamt);
+            dest = rd;
+            break;
+        case 0x23: /* subu */
+            val = SUB (REG (rs), REG (rt));
+            dest = rd;
+            break;
+        default:
+            BatchStop (b, mask, BATCH_HALTED);
+            return;
+        }
+        break;
+    case 0x9: /* addiu */
+        val = ADD (REG (rs), SPLAT (simm));
+        dest = rt;
+        break;
+    case 0xc: /* andi */
+        val = AND (REG (rs), SPLAT (uimm));
+        dest = rt;
+        break;
+    case 0xd: /* ori */
+        val = OR (REG (rs), SPLAT (uimm));
+        dest = rt;
+        break;
+    case 0xf: /* lui */
+        val = SPLAT (uimm << 16);
+        dest = rt;
+        break;
+    case 0x4: /* beq */
+        next = BLEND (next, ADD (next, SPLAT (simm * 4)),
+                      CMPEQ (REG (rs), REG (rt)));
+        break;
+    case 0x5: /* bne */
+        next = BLEND (ADD (next, SPLAT (simm * 4)), next,
+                      CMPEQ (REG (rs), REG (rt)));
+        break;
+    case 0x2: /* j */
+        next = SPLAT (target);
+        break;
+    case 0x3: /* jal */
+        val = next;
+        dest = 31;
+        next = SPLAT (target);
+        break;
+    case 0x23: /* lw -- memory is per lane, so loads are scalar */
+        BatchAddresses (b, ADD (REG (rs), SPLAT (simm)), mask, index);
+        for (l=0; l<BATCH_LANES; l++) {
+            loaded[l] = mask[l] ? b->memory[index[l]][l] : 0;
+        }
+        val = LOAD (loaded);
+        dest = rt;
+        break;
+    case 0x2b: /* sw */
+        BatchAddresses (b, ADD (REG (rs), SPLAT (simm)), mask, index);
+        for (l=0; l<BATCH_LANES; l++) {
+            if (mask[l]) {
+                b->memory[index[l]][l] = b->registers[rt][l];
+            }
+        }
+        break;
+    default:
+        BatchStop (b, mask, BATCH_HALTED);
+        return;
+    }
+
+    m = LOAD (mask);
+    if (dest > 0) {
+        STORE (b->registers[dest], m, val);
+    }
+    STORE (b->pc, m, next);
+    /* mask lanes are -1, so subtracting counts one instruction each */
+    STORE (b->executed, SPLAT (-1), SUB (LOAD (b->executed), m));
+}
+
+/*
+ *  Run the lanes in lockstep until all have halted or limit steps have
+ *  been taken. Lanes still running at the limit are marked BATCH_TIMEOUT.
+ */
+void BatchRun (BatchComputer* b, long limit) {
+    int mask [BATCH_LANES];
+    int leader, pc, k, l;
+    unsigned int instr;
+    long steps;
+
+    for (steps = 0; steps < limit; steps++) {
+        /* The lowest PC leads, so lanes reconverge after a split */
+        leader = -1;
+        for (l=0; l<BATCH_LANES; l++) {
+            if (b->status[l] == BATCH_RUNNING
+                && (leader < 0 || b->pc[l] < b->pc[leader])) {
+                leader = l;
+            }
+        }
+        if (leader < 0) {
+            return;
+        }
+        pc = b->pc[leader];
+        for (l=0; l<BATCH_LANES; l++) {
+            mask[l] = b->status[l] == BATCH_RUNNING && b->pc[l] == pc ? -1 : 0;
+        }
+
+        if ((pc & 3) != 0 || pc < 0x00400000
+            || pc >= 0x00400000 + 4*(MAXNUMINSTRS+MAXNUMDATA)) {
+            BatchStop (b, mask, BATCH_FAULT);
+            continue;
+        }
+
+        /* Lanes that stored over this instruction run on their own */
+        k = (pc - 0x00400000)/4;
+        instr = b->memory[k][leader];
+        for (l=0; l<BATCH_LANES; l++) {
+            if (mask[l] && b->memory[k][l] != (int) instr) {
+                mask[l] = 0;
+            }
+        }
+
+        if (instr == 0) {
+            BatchStop (b, mask, BATCH_HALTED);
+        } else {
+            BatchExecute (b, instr, mask);
+        }
+    }
+
+    for (l=0; l<BATCH_LANES; l++) {
+        if (b->status[l] == BATCH_RUNNING) {
+            b->status[l] = BATCH_TIMEOUT;
+        }
+    }
+}
+
+/*
+ *  Run the program in filein once for each line of states, BATCH_LANES
+ *  instances at a time. Each line gives up to four initial values for
+ *  $a0-$a3; the final $v0 and $v1 of every instance are printed.
+ *  Returns 0 on success, -1 if the program is too big.
+ */
+int BatchSimulate (FILE* filein, FILE* states) {
+    static BatchComputer program, b;
+    static char* statusNames[] = { "running", "halted", "fault", "timeout" };
+    char line [200];
+    char *p, *end;
+    int lanes, instance, l, r;
+
+    if (BatchInit (&program, filein) != 0) {
+        return -1;
+    }
+
+    instance = 0;
+    do {
+        memcpy (&b, &program, sizeof (BatchComputer));
+        for (lanes=0; lanes<BATCH_LANES && fgets (line, sizeof (line), states); ) {
+            p = line;
+            for (r=4; r<8; r++) {
+                int value = strtol (p, &end, 0);
+                if (end == p) {
+                    break;
+                }
+                BatchSetRegister (&b, lanes, r, value);
+                p = end;
+            }
+            if (r > 4) {
+                lanes++;
+            }
+        }
+        for (l=lanes; l<BATCH_LANES; l++) {
+            b.status[l] = BATCH_HALTED;
+        }
+
+        BatchRun (&b, BATCH_STEP_LIMIT);
+
+        for (l=0; l<lanes; l++, instance++) {
+            printf ("Instance %d: v0 = %8.8x  v1 = %8.8x  (%s after %d instructions)\n",
+                instance, b.registers[2][l], b.registers[3][l],
+                statusNames[b.status[l]], b.executed[l]);
+        }
+    } while (lanes == BATCH_LANES);
+
+    return 0;
+}
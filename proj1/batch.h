@@ -0,0 +1,30 @@
+
+/*
+ *  Batch interpreter: BATCH_LANES independent copies of the simulated
+ *  computer run the same program in lockstep. State is kept in
+ *  structure-of-arrays form, one lane per instance, so each register
+ *  (and each memory word) is a single vector that AVX2 can operate on.
+ *
+ *  Lanes whose PCs diverge are split: every step executes the
+ *  instruction at the lowest PC among the running lanes, for exactly
+ *  the lanes sitting at that PC, and the others wait until they are
+ *  rejoined there.
+ */
+
+#define BATCH_LANES 8			/* one 256-bit vector of ints */
+#define BATCH_STEP_LIMIT 100000000L	/* lockstep rounds before giving up */
+
+typedef enum { BATCH_RUNNING=0, BATCH_HALTED, BATCH_FAULT, BATCH_TIMEOUT } LaneStatus;
+
+typedef struct {
+    int registers [32][BATCH_LANES];
+    int pc [BATCH_LANES];
+    int status [BATCH_LANES];
+    int executed [BATCH_LANES];		/* instructions executed per lane */
+    int memory [MAXNUMINSTRS+MAXNUMDATA][BATCH_LANES];
+} BatchComputer;
+
+int BatchInit (BatchComputer*, FILE*);
+void BatchSetRegister (BatchComputer*, int lane, int reg, int value);
+void BatchRun (BatchComputer*, long limit);
+int BatchSimulate (FILE* filein, FILE* states);
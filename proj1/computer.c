@@ -1,14 +1,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <netinet/in.h>
+#include <sys/mman.h>
 #include "computer.h"
+#include "trace.h"
+#include "ooo.h"
+#include "dataflow.h"
+#include "watch.h"
+#include "event.h"
+#include "console.h"
 #undef mips			/* gcc already has a def for mips */
 
 unsigned int endianSwap(unsigned int);
 
-void PrintInfo (int changedReg, int changedMem);
+void PrintRegisters ();
+void PrintMemory ();
 unsigned int Fetch (int);
 void Decode (unsigned int, DecodedInstr*, RegVals*);
+void DecodeFields (unsigned int, DecodedInstr*);
+void ReadRegisters (DecodedInstr*, RegVals*);
+void DecodeCached (int, unsigned int, DecodedInstr*, RegVals*);
+void FlushDecodeCache ();
 int Execute (DecodedInstr*, RegVals*);
 int Mem(DecodedInstr*, int, int *);
 void RegWrite(DecodedInstr*, int, int *);
@@ -18,6 +30,15 @@ void PrintInstruction (DecodedInstr*);
 /*Globally accessible Computer variable*/
 Computer mips;
 RegVals rVals;
+
+/*
+ *  Predecoded instructions for the text segment, indexed like
+ *  mips.memory. An entry stays valid until a sw writes over the word
+ *  it was decoded from, so the cache is always on, even for programs
+ *  that patch their own code.
+ */
+DecodedInstr decodeCache[MAXNUMINSTRS];
+char decodeValid[MAXNUMINSTRS];
 //R instruction funct codes
 int addu = 0x21;
 int and = 0x24;
@@ -27,6 +48,7 @@ int slt = 0x2a;
 int sll = 0x00;
 int srl = 0x02;
 int subu = 0x23;
+int sys = 0x0c;         //syscall; libc already has that name
 
 //I intruction op code
 int addiu = 0x9;
@@ -50,7 +72,48 @@ int jal = 0x3;
  *  The other arguments govern how the program interacts with the user.
  */
 void InitComputer (FILE* filein, int printingRegisters, int printingMemory,
-  int debugging, int interactive) {
+  int debugging, int interactive, int quiet) {
+    if (mips.memory == NULL) {
+        mips.memory = NewMemory ();
+        if (mips.memory == NULL) {
+            fprintf (stderr, "Can't allocate memory.\n");
+            exit (1);
+        }
+    }
+    if (LoadComputer (filein) != 0) {
+        fprintf (stderr, "Program too big.\n");
+        exit (1);
+    }
+
+    mips.printingRegisters = printingRegisters;
+    mips.printingMemory = printingMemory;
+    mips.interactive = interactive;
+    mips.debugging = debugging;
+    mips.quiet = quiet;
+}
+
+/*
+ *  Map memory for a computer, or return NULL if there is none. Memory
+ *  is mapped rather than part of mips so that it starts on a page
+ *  boundary and shares its pages with nothing else, which is what lets
+ *  watchpoints protect it.
+ */
+int* NewMemory () {
+    int* memory = mmap (NULL, (MAXNUMINSTRS+MAXNUMDATA)*4,
+        PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+void FreeMemory (int* memory) {
+    munmap (memory, (MAXNUMINSTRS+MAXNUMDATA)*4);
+}
+
+/*
+ *  Reset the registers and memory of mips, which must already have
+ *  memory, and read the program in filein into it. Returns 0, or -1 if
+ *  the program doesn't fit.
+ */
+int LoadComputer (FILE* filein) {
     int k;
     unsigned int instr;
 
@@ -73,125 +136,213 @@ void InitComputer (FILE* filein, int printingRegisters, int printingMemory,
         mips.memory[k] = ntohl(endianSwap(instr));
         k++;
         if (k>MAXNUMINSTRS) {
-            fprintf (stderr, "Program too big.\n");
-            exit (1);
+            return -1;
         }
     }
 
-    mips.printingRegisters = printingRegisters;
-    mips.printingMemory = printingMemory;
-    mips.interactive = interactive;
-    mips.debugging = debugging;
+    FlushDecodeCache ();
+    mips.pc = 0x00400000;
+    mips.exited = 0;
+    mips.exitCode = 0;
+    mips.heapBreak = HEAP_BASE;
+    return 0;
 }
 
 unsigned int endianSwap(unsigned int i) {
     return (i>>24)|(i>>8&0x0000ff00)|(i<<8&0x00ff0000)|(i<<24);
 }
 
-/*
- *  Run the simulation.
- */
-void Simulate () {
-    char s[40];  /* used for handling interactive input */
-    unsigned int instr;
-    int changedReg=-1, changedMem=-1, val;
-    DecodedInstr d;
-    
-    /* Initialize the PC to the start of the code section */
-    mips.pc = 0x00400000;
-    while (1) {
-        if (mips.interactive) {
-            printf ("> ");
-            fgets (s,sizeof(s),stdin);
-            if (s[0] == 'q') {
-                return;
-            }
+/* Print all 32 registers, four to a line. */
+void PrintRegisters () {
+    int k;
+    for (k=0; k<32; k++) {
+        printf ("r%2.2d: %8.8x  ", k, mips.registers[k]);
+        if ((k+1)%4 == 0) {
+            printf ("\n");
         }
+    }
+}
 
-        /* Fetch instr at mips.pc, returning it in instr */
-        instr = Fetch (mips.pc);
-
-        printf ("Executing instruction at %8.8x: %8.8x\n", mips.pc, instr);
-
-     /* 
-	 * Decode instr, putting decoded instr in d
-	 * Note that we reuse the d struct for each instruction.
-	 */
-        Decode (instr, &d, &rVals);
-        
-        /*Print decoded instruction*/
-        PrintInstruction(&d);
-
-        /* 
-	 * Perform computation needed to execute d, returning computed value 
-	 * in val 
-	 */
-        val = Execute(&d, &rVals);
+/* Print every nonzero word of the data segment. */
+void PrintMemory () {
+    int addr;
+    printf ("Nonzero memory\n");
+    printf ("ADDR	  CONTENTS\n");
+    for (addr = 0x00400000+4*MAXNUMINSTRS;
+         addr < 0x00400000+4*(MAXNUMINSTRS+MAXNUMDATA);
+         addr = addr+4) {
+        if (Fetch (addr) != 0) {
+            printf ("%8.8x  %8.8x\n", addr, Fetch (addr));
+        }
+    }
+}
 
-	UpdatePC(&d,val);
+/*
+ *  The simulation loop, specialized for every combination of the run
+ *  flags. See simloop.h.
+ */
+#define SIM_PASTE(a,b) a##b
+#define SIM_NAME(a,b) SIM_PASTE(a,b)
+#define SIM_VARIANTS 32
+
+#define SIM_VARIANT 0
+#include "simloop.h"
+#define SIM_VARIANT 1
+#include "simloop.h"
+#define SIM_VARIANT 2
+#include "simloop.h"
+#define SIM_VARIANT 3
+#include "simloop.h"
+#define SIM_VARIANT 4
+#include "simloop.h"
+#define SIM_VARIANT 5
+#include "simloop.h"
+#define SIM_VARIANT 6
+#include "simloop.h"
+#define SIM_VARIANT 7
+#include "simloop.h"
+#define SIM_VARIANT 8
+#include "simloop.h"
+#define SIM_VARIANT 9
+#include "simloop.h"
+#define SIM_VARIANT 10
+#include "simloop.h"
+#define SIM_VARIANT 11
+#include "simloop.h"
+#define SIM_VARIANT 12
+#include "simloop.h"
+#define SIM_VARIANT 13
+#include "simloop.h"
+#define SIM_VARIANT 14
+#include "simloop.h"
+#define SIM_VARIANT 15
+#include "simloop.h"
+#define SIM_VARIANT 16
+#include "simloop.h"
+#define SIM_VARIANT 17
+#include "simloop.h"
+#define SIM_VARIANT 18
+#include "simloop.h"
+#define SIM_VARIANT 19
+#include "simloop.h"
+#define SIM_VARIANT 20
+#include "simloop.h"
+#define SIM_VARIANT 21
+#include "simloop.h"
+#define SIM_VARIANT 22
+#include "simloop.h"
+#define SIM_VARIANT 23
+#include "simloop.h"
+#define SIM_VARIANT 24
+#include "simloop.h"
+#define SIM_VARIANT 25
+#include "simloop.h"
+#define SIM_VARIANT 26
+#include "simloop.h"
+#define SIM_VARIANT 27
+#include "simloop.h"
+#define SIM_VARIANT 28
+#include "simloop.h"
+#define SIM_VARIANT 29
+#include "simloop.h"
+#define SIM_VARIANT 30
+#include "simloop.h"
+#define SIM_VARIANT 31
+#include "simloop.h"
+
+static void (*simulateVariants[SIM_VARIANTS]) () = {
+    SimulateVariant0, SimulateVariant1, SimulateVariant2, SimulateVariant3,
+    SimulateVariant4, SimulateVariant5, SimulateVariant6, SimulateVariant7,
+    SimulateVariant8, SimulateVariant9, SimulateVariant10, SimulateVariant11,
+    SimulateVariant12, SimulateVariant13, SimulateVariant14, SimulateVariant15,
+    SimulateVariant16, SimulateVariant17, SimulateVariant18, SimulateVariant19,
+    SimulateVariant20, SimulateVariant21, SimulateVariant22, SimulateVariant23,
+    SimulateVariant24, SimulateVariant25, SimulateVariant26, SimulateVariant27,
+    SimulateVariant28, SimulateVariant29, SimulateVariant30, SimulateVariant31
+};
 
-        /* 
-	 * Perform memory load or store. Place the
-	 * address of any updated memory in *changedMem, 
-	 * otherwise put -1 in *changedMem. 
-	 * Return any memory value that is read, otherwise return -1.
-         */
-        val = Mem(&d, val, &changedMem);
+/*
+ *  Run the simulation. The flags can't change during a run, so the
+ *  matching loop is picked once here.
+ */
+void Simulate () {
+    int variant;
 
-        /* 
-	 * Write back to register. If the instruction modified a register--
-	 * (including jal, which modifies $ra) --
-         * put the index of the modified register in *changedReg,
-         * otherwise put -1 in *changedReg.
-         */
-        RegWrite(&d, val, &changedReg);
+    variant = (mips.interactive ? 1 : 0)
+        | (mips.quiet ? 2 : 0)
+        | (mips.printingRegisters ? 4 : 0)
+        | (mips.printingMemory ? 8 : 0)
+        | (traceActive || oooActive || dataflowActive || eventActive ? 16 : 0);
 
-        PrintInfo (changedReg, changedMem);
-    }
+    /* Initialize the PC to the start of the code section */
+    mips.pc = 0x00400000;
+    simulateVariants[variant] ();
 }
 
 /*
- *  Print relevant information about the state of the computer.
- *  changedReg is the index of the register changed by the instruction
- *  being simulated, otherwise -1.
- *  changedMem is the address of the memory location changed by the
- *  simulated instruction, otherwise -1.
- *  Previously initialized flags indicate whether to print all the
- *  registers or just the one that changed, and whether to print
- *  all the nonzero memory or just the memory location that changed.
+ *  Execute the instruction at mips.pc without printing anything, for
+ *  tools that drive the simulator themselves. Instead of exiting the
+ *  way Simulate() does, returns STEP_HALTED if the pc is outside memory,
+ *  the instruction isn't implemented or it is an exit syscall (leaving
+ *  the status in mips.exitCode), and STEP_FAULT if it is a bad load or
+ *  store or an unknown syscall; either way no other state has changed.
+ *  Console output goes wherever ConsoleAttach() last sent it.
  */
-void PrintInfo ( int changedReg, int changedMem) {
-    int k, addr;
-    printf ("New pc = %8.8x\n", mips.pc);
-    if (!mips.printingRegisters && changedReg == -1) {
-        printf ("No register was updated.\n");
-    } else if (!mips.printingRegisters) {
-        printf ("Updated r%2.2d to %8.8x\n",
-        changedReg, mips.registers[changedReg]);
-    } else {
-        for (k=0; k<32; k++) {
-            printf ("r%2.2d: %8.8x  ", k, mips.registers[k]);
-            if ((k+1)%4 == 0) {
-                printf ("\n");
-            }
-        }
+StepResult Step () {
+    unsigned int instr;
+    int changedReg, changedMem, val;
+    DecodedInstr d;
+
+    if (!ValidAddress (mips.pc)) {
+        return STEP_HALTED;
     }
-    if (!mips.printingMemory && changedMem == -1) {
-        printf ("No memory location was updated.\n");
-    } else if (!mips.printingMemory) {
-        printf ("Updated memory at address %8.8x to %8.8x\n",
-        changedMem, Fetch (changedMem));
-    } else {
-        printf ("Nonzero memory\n");
-        printf ("ADDR	  CONTENTS\n");
-        for (addr = 0x00400000+4*MAXNUMINSTRS;
-             addr < 0x00400000+4*(MAXNUMINSTRS+MAXNUMDATA);
-             addr = addr+4) {
-            if (Fetch (addr) != 0) {
-                printf ("%8.8x  %8.8x\n", addr, Fetch (addr));
-            }
+    instr = Fetch (mips.pc);
+    if (!ValidInstr (instr)) {
+        return STEP_HALTED;
+    }
+    DecodeCached (mips.pc, instr, &d, &rVals);
+    if (d.type == R && d.regs.r.funct == sys) {
+        switch (ConsoleSyscall (mips.registers[2], mips.registers[4], &val)) {
+        case SYSCALL_EXIT:
+            return STEP_HALTED;
+        case SYSCALL_UNKNOWN:
+            return STEP_FAULT;
+        default:
+            mips.pc += 4;
+            RegWrite (&d, val, &changedReg);
+            return STEP_OK;
         }
     }
+    val = Execute (&d, &rVals);
+    if (d.type == I && (d.op == lw || d.op == sw)
+        && !ValidAddress (val) && !ConsoleAddress (val)) {
+        return STEP_FAULT;
+    }
+    UpdatePC (&d, val);
+    val = Mem (&d, val, &changedMem);
+    RegWrite (&d, val, &changedReg);
+    return STEP_OK;
+}
+
+/* Return nonzero if addr is an aligned word address inside memory. */
+int ValidAddress (int addr) {
+    return (addr & 3) == 0 && addr >= 0x00400000
+        && addr < 0x00400000 + 4*(MAXNUMINSTRS+MAXNUMDATA);
+}
+
+/* Return nonzero if instr is one of the instructions implemented here. */
+int ValidInstr (unsigned int instr) {
+    int op = instr>>26, funct = instr & 0x3f;
+
+    if (instr == 0) {
+        return 0;
+    } else if (op == 0) {
+        return funct == addu || funct == and || funct == jr || funct == or
+            || funct == slt || funct == sll || funct == srl || funct == subu
+            || funct == sys;
+    }
+    return op == j || op == jal || op == addiu || op == andi || op == beq
+        || op == bne || op == lui || op == lw || op == ori || op == sw;
 }
 
 /*
@@ -204,6 +355,46 @@ unsigned int Fetch ( int addr) {
 
 /* Decode instr, returning decoded instruction. */
 void Decode ( unsigned int instr, DecodedInstr* d, RegVals* rVals) {
+    DecodeFields(instr, d);
+    ReadRegisters(d, rVals);
+}
+
+/*
+ *  Decode instr at pc, using the predecoded copy when the decode cache
+ *  holds one. Register values are always read fresh.
+ */
+void DecodeCached ( int pc, unsigned int instr, DecodedInstr* d, RegVals* rVals) {
+    unsigned int k = (pc-0x00400000)/4;
+
+    if(k < MAXNUMINSTRS){
+        if(!decodeValid[k]){
+            DecodeFields(instr, &decodeCache[k]);
+            decodeValid[k] = 1;
+        }
+        *d = decodeCache[k];
+    }
+    else
+        DecodeFields(instr, d);             //executing from the data segment
+    ReadRegisters(d, rVals);
+}
+
+/* Fill the decode cache entry for the instruction at pc ahead of time. */
+void Predecode (int pc) {
+    DecodedInstr d;
+    RegVals unused;
+
+    DecodeCached (pc, Fetch (pc), &d, &unused);
+}
+
+void FlushDecodeCache () {
+    int k;
+    for (k=0; k<MAXNUMINSTRS; k++) {
+        decodeValid[k] = 0;
+    }
+}
+
+/* Split instr into its fields, without looking at any register. */
+void DecodeFields ( unsigned int instr, DecodedInstr* d) {
     if(instr == 0)                              //invalid instruction
         exit(0);
     unsigned int temp;
@@ -216,18 +407,15 @@ void Decode ( unsigned int instr, DecodedInstr* d, RegVals* rVals) {
         d->type = R;                            //R instruction
 
         temp = temp>>27;
-        d->regs.r.rs = temp;
-        rVals->R_rs = mips.registers[temp];     //rs
+        d->regs.r.rs = temp;                    //rs
 
         temp = instr<<11;
         temp =temp>>27;
-        d->regs.r.rt = temp;
-        rVals->R_rt = mips.registers[temp];     //rt
+        d->regs.r.rt = temp;                    //rt
 
         temp = instr<<16;
         temp = temp>>27;
-        d->regs.r.rd = temp;
-        rVals->R_rd = mips.registers[temp];     //rd
+        d->regs.r.rd = temp;                    //rd
 
         temp = instr<<21;
         temp = temp>>27;
@@ -248,13 +436,11 @@ void Decode ( unsigned int instr, DecodedInstr* d, RegVals* rVals) {
     else if(d->op == addiu || d->op == andi || d->op == beq || d->op == bne || d->op == lui || d->op == lw || d->op == ori || d->op == sw){
         d->type = I;                            //I instruction
         temp = temp>>27;
-        d->regs.i.rs = temp;
-        rVals->R_rs = mips.registers[temp];     //rs
+        d->regs.i.rs = temp;                    //rs
 
         temp = instr<<11;
         temp = temp>>27;
-        d->regs.i.rt = temp;
-        rVals->R_rt = mips.registers[temp];     //rt
+        d->regs.i.rt = temp;                    //rt
 
         temp = instr<<16;
         temp = temp>>16;
@@ -266,6 +452,19 @@ void Decode ( unsigned int instr, DecodedInstr* d, RegVals* rVals) {
         exit(0);                                //if none of these exit   
 }
 
+/* Load the register operands of a decoded instruction into rVals. */
+void ReadRegisters ( DecodedInstr* d, RegVals* rVals) {
+    if(d->type == R){
+        rVals->R_rs = mips.registers[d->regs.r.rs];
+        rVals->R_rt = mips.registers[d->regs.r.rt];
+        rVals->R_rd = mips.registers[d->regs.r.rd];
+    }
+    else if(d->type == I){
+        rVals->R_rs = mips.registers[d->regs.i.rs];
+        rVals->R_rt = mips.registers[d->regs.i.rt];
+    }
+}
+
 /*
  *  Print the disassembled version of the given instruction
  *  followed by a newline.
@@ -298,6 +497,9 @@ void PrintInstruction ( DecodedInstr* d) {
         else if(d->regs.r.funct == subu){
             printf("subu\t$%d, $%d, $%d\n", d->regs.r.rd, d->regs.r.rs, d->regs.r.rt);
         }
+        else if(d->regs.r.funct == sys){
+            printf("syscall\n");
+        }
     }
 
     //I INSTRUCTION
@@ -373,13 +575,16 @@ int Execute ( DecodedInstr* d, RegVals* rVals) {
 
         }
         else if(d->regs.r.funct == srl){
-            int result = rVals->R_rt>>d->regs.r.shamt;
+            int result = (unsigned int)rVals->R_rt>>d->regs.r.shamt;   //logical
             return result;
         }
         else if(d->regs.r.funct == subu){
             int diff = rVals->R_rs - rVals->R_rt;
             return diff;
         }
+        else if(d->regs.r.funct == sys){
+            return Syscall(mips.registers[2], mips.registers[4]);   //new $v0
+        }
 
     }
     else if(d->type == I){
@@ -388,7 +593,7 @@ int Execute ( DecodedInstr* d, RegVals* rVals) {
             return sum;
         }
         else if(d->op == andi){
-            int result = rVals->R_rs & d->regs.i.addr_or_immed;
+            int result = rVals->R_rs & (d->regs.i.addr_or_immed & 0xffff);   //zero-extended
             return result;
         }
         else if(d->op == beq){
@@ -412,7 +617,7 @@ int Execute ( DecodedInstr* d, RegVals* rVals) {
             return result;
         }
         else if(d->op == ori){
-            int result = rVals->R_rs | d->regs.i.addr_or_immed;
+            int result = rVals->R_rs | (d->regs.i.addr_or_immed & 0xffff);   //zero-extended
             return result;
         }
         else if(d->op == sw){
@@ -465,8 +670,44 @@ void UpdatePC ( DecodedInstr* d, int val) {
  *
  */
 int Mem( DecodedInstr* d, int val, int *changedMem) {
-    /* Your code goes here */
-  return val;
+    *changedMem = -1;
+    if (d->type != I || (d->op != lw && d->op != sw)) {
+        return val;
+    }
+
+    /* val holds the effective address computed by Execute() */
+    if (ConsoleAddress (val)) {
+        if (d->op == lw) {
+            return ConsoleLoad (val);
+        }
+        ConsoleStore (val, mips.registers[d->regs.i.rt]);
+        return val;
+    }
+    if (!ValidAddress (val)) {
+        fprintf (stderr, "Memory access exception at %8.8x\n", val);
+        exit (1);
+    }
+
+    if (d->op == lw) {
+        if (traceActive) {
+            TraceAccess (TRACE_READ, val, 4);
+        }
+        return mips.memory[(val-0x00400000)/4];
+    }
+
+    if (traceActive) {
+        TraceAccess (TRACE_WRITE, val, 4);
+    }
+    mips.memory[(val-0x00400000)/4] = mips.registers[d->regs.i.rt];
+    if (val < 0x00400000 + 4*MAXNUMINSTRS) {
+        /* Code was overwritten, so its predecoded copy is stale */
+        decodeValid[(val-0x00400000)/4] = 0;
+    }
+    if (watchPending) {
+        WatchRearm ();
+    }
+    *changedMem = val;
+    return val;
 }
 
 /* 
@@ -479,9 +720,18 @@ void RegWrite( DecodedInstr* d, int val, int *changedReg) {
     /* Your code goes here */
 
     if(d->type == R){
-        if(d->op == jr){
+        if(d->regs.r.funct == jr){
             *changedReg = -1;
         }
+        else if(d->regs.r.funct == sys){
+            //only read_int and sbrk return anything
+            if(mips.registers[2] == 5 || mips.registers[2] == 9){
+                mips.registers[2] = val;
+                *changedReg = 2;
+            }
+            else
+                *changedReg = -1;
+        }
         else{
             mips.registers[d->regs.r.rd] = val;
             *changedReg = d->regs.r.rd;
@@ -507,4 +757,10 @@ void RegWrite( DecodedInstr* d, int val, int *changedReg) {
     }
     else
         *changedReg = -1;
+
+    /* $0 is hardwired to zero, so a write to it changes nothing */
+    if(*changedReg == 0){
+        mips.registers[0] = 0;
+        *changedReg = -1;
+    }
 }
@@ -1,12 +1,16 @@
 
 #define MAXNUMINSTRS 1024	/* max # instrs in a program */
 #define MAXNUMDATA 3072		/* max # data words */
+#define HEAP_BASE (0x00400000 + 4*(MAXNUMINSTRS+MAXNUMDATA/2))
+				/* first sbrk break; static data goes below */
 
 struct SimulatedComputer {
-    int memory [MAXNUMINSTRS+MAXNUMDATA];
+    int *memory;	/* MAXNUMINSTRS+MAXNUMDATA words on their own host pages */
     int registers [32];
     int pc;
-    int printingRegisters, printingMemory, interactive, debugging;
+    int printingRegisters, printingMemory, interactive, debugging, quiet;
+    int exited, exitCode;	/* set when the program runs exit or exit2 */
+    int heapBreak;		/* sbrk's break, HEAP_BASE after loading */
 };
 typedef struct SimulatedComputer Computer;
 
@@ -46,6 +50,16 @@ typedef struct {
   int R_rd;
 } RegVals;
 
+typedef enum { STEP_OK=0, STEP_HALTED, STEP_FAULT } StepResult;
+
 void InitComputer (FILE*, int printingRegisters, int printingMemory,
-    int debugging, int interactive);
+    int debugging, int interactive, int quiet);
+int* NewMemory ();
+void FreeMemory (int* memory);
+int LoadComputer (FILE*);
+void FlushDecodeCache ();
+void Predecode (int pc);
 void Simulate ();
+StepResult Step ();
+int ValidInstr (unsigned int instr);
+int ValidAddress (int addr);
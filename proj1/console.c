@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "computer.h"
+#include "console.h"
+#undef mips			/* gcc already has a def for mips */
+
+extern Computer mips;
+
+static char buffer[CONSOLE_BUFFER_SIZE];
+static int buffered;
+static int flushAtExit;
+static int attached;
+static FILE* input;
+static FILE* output;
+
+void ConsoleFlush () {
+    FILE* out = attached ? output : stdout;
+
+    if (out != NULL) {
+        fwrite (buffer, 1, buffered, out);
+        fflush (out);
+    }
+    buffered = 0;
+}
+
+/* Use in and out from now on, after flushing what the old output has pending */
+void ConsoleAttach (FILE* in, FILE* out) {
+    ConsoleFlush ();
+    attached = 1;
+    input = in;
+    output = out;
+}
+
+/* Buffer n characters, which reach the host only when the buffer fills */
+static void Put (const char* s, int n) {
+    if (!flushAtExit && !attached) {
+        atexit (ConsoleFlush);
+        flushAtExit = 1;
+    }
+    while (n > 0) {
+        if (buffered == CONSOLE_BUFFER_SIZE) {
+            ConsoleFlush ();
+        }
+        buffer[buffered++] = *s++;
+        n--;
+    }
+}
+
+/* End a write by the program, flushing it if the listing is being printed */
+static void Written () {
+    if (!mips.quiet) {
+        ConsoleFlush ();
+    }
+}
+
+static FILE* Input () {
+    return attached ? input : stdin;
+}
+
+/* Next input character, or EOF */
+static int Get () {
+    ConsoleFlush ();
+    return Input () != NULL ? getc (Input ()) : EOF;
+}
+
+/* Byte at addr of guest memory, or -1 outside it */
+static int Byte (int addr) {
+    if (addr < 0x00400000 || addr >= 0x00400000 + 4*(MAXNUMINSTRS+MAXNUMDATA)) {
+        return -1;
+    }
+    return mips.memory[(addr-0x00400000)/4] >> 8*(addr & 3) & 0xff;
+}
+
+/*
+ *  Perform system call code with $a0 = arg without exiting. Returns
+ *  SYSCALL_OK with the new value of $v0 in *value, SYSCALL_EXIT with the
+ *  program's exit status in *value, or SYSCALL_UNKNOWN.
+ */
+SyscallResult ConsoleSyscall (int code, int arg, int* value) {
+    char s[16];
+    int c;
+    int top;
+
+    *value = code;
+    switch (code) {
+    case 1:
+        Put (s, sprintf (s, "%d", arg));
+        break;
+    case 4:
+        for (; (c = Byte (arg)) > 0; arg++) {
+            s[0] = c;
+            Put (s, 1);
+        }
+        break;
+    case 5:
+        ConsoleFlush ();
+        if (Input () == NULL || fscanf (Input (), "%d", value) != 1) {
+            *value = 0;
+        }
+        return SYSCALL_OK;
+    case 9:
+        /* The heap grows up from HEAP_BASE; -1 once it would pass $sp */
+        top = 0x00400000 + 4*(MAXNUMINSTRS+MAXNUMDATA);
+        if (mips.registers[29] < top) {
+            top = mips.registers[29] & ~3;
+        }
+        *value = mips.heapBreak;
+        if (arg < 0 || arg > top - mips.heapBreak) {
+            *value = -1;
+            return SYSCALL_OK;
+        }
+        mips.heapBreak += (arg+3) & ~3;
+        return SYSCALL_OK;
+    case 10:
+    case 17:
+        *value = code == 10 ? 0 : arg;
+        mips.exited = 1;
+        mips.exitCode = *value;
+        return SYSCALL_EXIT;
+    case 11:
+        s[0] = arg;
+        Put (s, 1);
+        break;
+    default:
+        return SYSCALL_UNKNOWN;
+    }
+    /* Only the print syscalls get here, with their output buffered whole */
+    Written ();
+    return SYSCALL_OK;
+}
+
+/*
+ *  Perform system call code with $a0 = arg, returning the new value of
+ *  $v0, for Simulate(). exit and exit2 end the simulator with the
+ *  program's status, and an unknown code is an exception, like a bad
+ *  memory access.
+ */
+int Syscall (int code, int arg) {
+    int value;
+
+    switch (ConsoleSyscall (code, arg, &value)) {
+    case SYSCALL_EXIT:
+        exit (value);
+    case SYSCALL_UNKNOWN:
+        ConsoleFlush ();
+        fprintf (stderr, "Unknown syscall %d at %8.8x\n", code, mips.pc);
+        exit (1);
+    default:
+        return value;
+    }
+}
+
+/* Return nonzero if addr is one of the console's device registers */
+int ConsoleAddress (int addr) {
+    return addr == CONSOLE_RECEIVER_CONTROL || addr == CONSOLE_RECEIVER_DATA
+        || addr == CONSOLE_TRANSMITTER_CONTROL || addr == CONSOLE_TRANSMITTER_DATA;
+}
+
+int ConsoleLoad (int addr) {
+    int c;
+
+    if (addr == CONSOLE_TRANSMITTER_CONTROL) {
+        return 1;
+    } else if (addr == CONSOLE_TRANSMITTER_DATA) {
+        return 0;
+    }
+    c = Get ();
+    if (addr == CONSOLE_RECEIVER_CONTROL) {
+        if (c == EOF) {
+            return 0;
+        }
+        ungetc (c, Input ());
+        return 1;
+    }
+    return c == EOF ? 0 : c;
+}
+
+void ConsoleStore (int addr, int value) {
+    char c = value;
+
+    if (addr == CONSOLE_TRANSMITTER_DATA) {
+        Put (&c, 1);
+        Written ();
+    }
+}
@@ -0,0 +1,51 @@
+
+/*
+ *  Guest I/O in the style of SPIM. The syscall instruction takes its
+ *  service number in $v0 and its argument in $a0:
+ *
+ *       1  print_int     print $a0 in decimal
+ *       4  print_string  print the NUL-terminated string at $a0
+ *       5  read_int      read a decimal integer into $v0
+ *       9  sbrk          grow the heap by $a0 bytes, old break in $v0
+ *                        (-1 if the heap would pass $sp)
+ *      10  exit          end the run with status 0
+ *      11  print_char    print the low byte of $a0
+ *      17  exit2         end the run with status $a0
+ *
+ *  The same console is also memory-mapped, as on SPIM: lw from
+ *  CONSOLE_RECEIVER_CONTROL gives 1 while input remains and lw from
+ *  CONSOLE_RECEIVER_DATA reads a character; sw to
+ *  CONSOLE_TRANSMITTER_DATA prints one, and the transmitter is always
+ *  ready. Strings are little-endian within each memory word.
+ *
+ *  The heap starts at HEAP_BASE, halfway through the data segment, so
+ *  the program's statically addressed data belongs below it. The break
+ *  is part of the Computer and LoadComputer() resets it.
+ *
+ *  Output goes through a CONSOLE_BUFFER_SIZE buffer that reaches the
+ *  host when it fills, before input is read, and at exit. When every
+ *  instruction is being printed it is also flushed once after each
+ *  print syscall or transmitter store, so the program's output lines up
+ *  with the listing.
+ *
+ *  The console uses stdin and stdout until ConsoleAttach() gives it
+ *  other streams, after which it is flushed only by ConsoleFlush(). A
+ *  NULL input stream is always at end of file, and output to a NULL
+ *  stream is dropped.
+ */
+
+#define CONSOLE_BUFFER_SIZE (1<<16)
+#define CONSOLE_RECEIVER_CONTROL 0xffff0000
+#define CONSOLE_RECEIVER_DATA 0xffff0004
+#define CONSOLE_TRANSMITTER_CONTROL 0xffff0008
+#define CONSOLE_TRANSMITTER_DATA 0xffff000c
+
+typedef enum { SYSCALL_OK=0, SYSCALL_EXIT, SYSCALL_UNKNOWN } SyscallResult;
+
+int Syscall (int code, int arg);
+SyscallResult ConsoleSyscall (int code, int arg, int* value);
+void ConsoleAttach (FILE* in, FILE* out);
+int ConsoleAddress (int addr);
+int ConsoleLoad (int addr);
+void ConsoleStore (int addr, int value);
+void ConsoleFlush ();
@@ -0,0 +1,351 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <netinet/in.h>
+#include "computer.h"
+#include "../proj2/tips.h"
+#undef mips			/* gcc already has a def for mips */
+
+/*
+ *  Lockstep co-simulation of this simulator against the CPU core of
+ *  proj2 (TIPS). Both load the same program and execute it one
+ *  instruction at a time; after every instruction the pc and all 32
+ *  registers are compared, and the first difference stops the run.
+ *  The run ends normally when this simulator reaches an instruction
+ *  it doesn't implement, since TIPS implements a larger subset.
+ *
+ *  With -g the programs are random ones built from the common subset,
+ *  so large numbers of them can be checked without writing any. A
+ *  program that shows a difference is saved for replaying.
+ */
+
+#define COSIM_LIMIT 10000000	/* instructions per program */
+#define COSIM_DATA 0x00402000	/* random programs load and store here */
+#define COSIM_BLOCK 24		/* instructions per random block */
+
+#define TRUE 1
+#define FALSE 0
+
+extern Computer mips;
+
+void PrintInstruction (DecodedInstr*);
+void Decode (unsigned int, DecodedInstr*, RegVals*);
+unsigned int Fetch (int);
+
+/*
+ *  TIPS state and GUI entry points. The core only draws and logs
+ *  through these, so here they do nothing.
+ */
+char* program_name;
+CacheView view;
+int gui_active = 1;		/* keeps accessDRAM() from printing */
+
+void append_log (char* msg) { }
+void highlight_block (unsigned int set_num, unsigned int assoc_num) { }
+void highlight_offset (unsigned int set_num, unsigned int assoc_num,
+    unsigned int offset, CacheAction action) { }
+void refresh_register_display () { }
+void refresh_cache_display () { }
+void flush_drawlist () { }
+void stop_run () { }
+
+/*
+ *  Load the program in filein into both simulators and give TIPS the
+ *  same initial registers as this simulator.
+ */
+static void Load (FILE* filein) {
+    word zero = 0, instr;
+    int k;
+
+    InitComputer (filein, FALSE, FALSE, FALSE, FALSE, TRUE);
+
+    /* TIPS keeps instructions big-endian and data in host order */
+    for (k=0; k<PHYSICAL_PAGE_SIZE/4; k++) {
+        accessDRAM (PROGRAM_START + 4*k, (byte*) &zero, WORD_SIZE, WRITE);
+    }
+    for (k=0; k<MAXNUMINSTRS; k++) {
+        instr = htonl (mips.memory[k]);
+        accessDRAM (PROGRAM_START + 4*k, (byte*) &instr, WORD_SIZE, WRITE);
+    }
+    flush_cache ();
+    for (k=0; k<32; k++) {
+        registers[k] = mips.registers[k];
+    }
+    hilo[0] = hilo[1] = 0;
+    PC = mips.pc;
+}
+
+/*
+ *  Print the registers that differ after the instruction at pc. Returns
+ *  nonzero if anything does.
+ */
+static int Compare (int pc, unsigned int instr, long count) {
+    DecodedInstr d;
+    RegVals rv;
+    int k, diverged = mips.pc != PC;
+
+    for (k=0; k<32 && !diverged; k++) {
+        diverged = (word) mips.registers[k] != registers[k];
+    }
+    if (!diverged) {
+        return 0;
+    }
+
+    printf ("Divergence after %ld instructions, at %8.8x: %8.8x  ", count, pc, instr);
+    Decode (instr, &d, &rv);
+    PrintInstruction (&d);
+    printf ("          proj1     proj2\n");
+    if (mips.pc != PC) {
+        printf ("  pc      %8.8x  %8.8x\n", mips.pc, PC);
+    }
+    for (k=0; k<32; k++) {
+        if ((word) mips.registers[k] != registers[k]) {
+            printf ("  r%2.2d     %8.8x  %8.8x\n", k, mips.registers[k], registers[k]);
+        }
+    }
+    return 1;
+}
+
+/*
+ *  Run the loaded program in both simulators until one differs from
+ *  the other, the program stops, or limit instructions have run.
+ *  Returns nonzero on a difference; *count gets the instructions run.
+ */
+static int Lockstep (long limit, long* count) {
+    int pc;
+    unsigned int instr;
+
+    for (*count=0; *count<limit; (*count)++) {
+        pc = mips.pc;
+        if (Step () != STEP_OK) {
+            break;
+        }
+        instr = Fetch (pc);	/* pc is known to be in memory now */
+        step_processor ();
+        if (Compare (pc, instr, *count+1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Random number from 0 to n-1 */
+static unsigned int Random (unsigned int n) {
+    return (unsigned int) rand () % n;
+}
+
+/* Registers random instructions may overwrite: $0 and $t0-$t7 */
+static int Dest () {
+    int r = Random (9);
+    return r == 0 ? 0 : r + 7;
+}
+
+/* Registers random instructions read: those plus $s0, $s1, $sp and $ra */
+static int Source () {
+    static int extra[4] = { 16, 17, 29, 31 };
+    int r = Random (13);
+    return r < 9 ? (r == 0 ? 0 : r + 7) : extra[r-9];
+}
+
+#define RTYPE(rs,rt,rd,shamt,funct) \
+    ((rs)<<21 | (rt)<<16 | (rd)<<11 | (shamt)<<6 | (funct))
+#define ITYPE(op,rs,rt,immed) ((op)<<26 | (rs)<<21 | (rt)<<16 | ((immed) & 0xffff))
+#define JTYPE(op,target) ((op)<<26 | ((0x00400000 + 4*(target))>>2 & 0x03ffffff))
+
+/*
+ *  Fill prog[start..end) with random instructions. Control transfers
+ *  only go forward, to at most end, so every block runs to its end.
+ *  A jr is the last of three instructions that build its target in $t1,
+ *  and nothing may branch into the middle of those three.
+ */
+static void RandomBlock (unsigned int* prog, int start, int end) {
+    static int functs[6] = { 0x21, 0x24, 0x25, 0x2a, 0x23, 0x00 };
+    char jrStart[MAXNUMINSTRS+1], inside[MAXNUMINSTRS+1];
+    int k, target;
+
+    /* Place the jr sequences first so branches can steer around them */
+    for (k=start; k<=end; k++) {
+        jrStart[k] = inside[k] = 0;
+    }
+    for (k=start; k+3<end; k++) {
+        if (Random (16) == 0) {
+            jrStart[k] = inside[k+1] = inside[k+2] = 1;
+            k += 2;
+        }
+    }
+
+    for (k=start; k<end; k++) {
+        do {
+            target = k+1 + Random (end-k);
+        } while (inside[target]);
+        if (jrStart[k]) {
+            while (target < k+3 || inside[target]) {
+                target = k+3 + Random (end-k-2);
+            }
+            prog[k++] = ITYPE (0x0f, 0, 9, 0x0040);
+            prog[k++] = ITYPE (0x0d, 9, 9, 4*target);
+            prog[k] = RTYPE (9, 0, 0, 0, 0x08);
+            continue;
+        }
+        switch (Random (15)) {
+        case 0: case 1: case 2: case 3: case 4: case 5:
+            /* addu, and, or, slt, subu, sll */
+            prog[k] = RTYPE (Source (), Source (), Dest (), 0, functs[Random (6)]);
+            break;
+        case 6:
+            /* sll, srl */
+            prog[k] = RTYPE (0, Source (), Dest (), Random (32), Random (2) ? 0x00 : 0x02);
+            break;
+        case 7: case 8:
+            /* addiu */
+            prog[k] = ITYPE (0x09, Source (), Dest (), Random (0x10000));
+            break;
+        case 9:
+            /* andi, ori */
+            prog[k] = ITYPE (Random (2) ? 0x0c : 0x0d, Source (), Dest (), Random (0x10000));
+            break;
+        case 10:
+            /* lui */
+            prog[k] = ITYPE (0x0f, 0, Dest (), Random (0x10000));
+            break;
+        case 11:
+            /* lw */
+            prog[k] = ITYPE (0x23, 16, Dest (), 4*Random (0x800));
+            break;
+        case 12:
+            /* sw */
+            prog[k] = ITYPE (0x2b, 16, Source (), 4*Random (0x800));
+            break;
+        case 13:
+            /* beq, bne */
+            prog[k] = ITYPE (Random (2) ? 0x04 : 0x05, Source (), Source (), target-(k+1));
+            break;
+        default:
+            /* j, jal */
+            prog[k] = JTYPE (Random (2) ? 0x02 : 0x03, target);
+            break;
+        }
+        if (prog[k] == 0) {
+            /* A zero word would end the program here */
+            prog[k] = RTYPE (0, 0, 0, 1, 0x00);
+        }
+    }
+}
+
+/*
+ *  Write a random program for the given seed to progout. $s0 points at
+ *  the data area every load and store uses and $s1 counts loop trips;
+ *  nothing else writes either one. Each block of random instructions
+ *  may be wrapped in a loop, so programs run far longer than they are.
+ */
+static void RandomProgram (unsigned int seed, FILE* progout) {
+    unsigned int prog[MAXNUMINSTRS];
+    int k = 0, top;
+
+    srand (seed);
+    prog[k++] = ITYPE (0x0f, 0, 16, COSIM_DATA>>16);
+    prog[k++] = ITYPE (0x0d, 16, 16, COSIM_DATA);
+    while (k + COSIM_BLOCK+3 < MAXNUMINSTRS) {
+        if (Random (2)) {
+            RandomBlock (prog, k, k+COSIM_BLOCK);
+            k += COSIM_BLOCK;
+            continue;
+        }
+        prog[k++] = ITYPE (0x09, 0, 17, 1 + Random (100));
+        top = k;
+        RandomBlock (prog, k, k+COSIM_BLOCK);
+        k += COSIM_BLOCK;
+        prog[k++] = ITYPE (0x09, 17, 17, -1);
+        prog[k] = ITYPE (0x05, 17, 0, top-(k+1));
+        k++;
+    }
+    prog[k++] = 0;
+
+    /* Dump files hold little-endian words */
+    for (top=0; top<k; top++) {
+        fwrite (&prog[top], 4, 1, progout);
+    }
+    rewind (progout);
+}
+
+int main (int argc, char *argv[]) {
+    int argIndex, c;
+    int generating = FALSE;
+    unsigned int seed = 0, programs = 1, n;
+    long limit = COSIM_LIMIT, count, total = 0;
+    char name[40];
+    FILE *filein, *progout;
+
+    for (argIndex=1; argIndex<argc && argv[argIndex][0]=='-'; argIndex++) {
+        /* Argument is an option, we hope one of -g, -c, -n. */
+        if (argIndex+1 >= argc) {
+            fprintf (stderr, "No value given for \"%s\".\n", argv[argIndex]);
+            exit (1);
+        }
+        switch (argv[argIndex][1]) {
+            case 'g':
+            /* -g <seed> checks random programs instead of a file */
+            generating = TRUE;
+            seed = strtoul (argv[++argIndex], NULL, 0);
+            break;
+            case 'c':
+            programs = strtoul (argv[++argIndex], NULL, 0);
+            break;
+            case 'n':
+            limit = strtol (argv[++argIndex], NULL, 0);
+            break;
+            default:
+            fprintf (stderr, "Invalid option \"%s\".\n", argv[argIndex]);
+            fprintf (stderr, "Usage: cosim [-n <limit>] <file> | cosim -g <seed> [-c <count>] [-n <limit>]\n");
+            exit (1);
+        }
+    }
+
+    /* TIPS runs with no caches, straight to DRAM */
+    init_memory ();
+
+    if (!generating) {
+        if (argIndex != argc-1) {
+            fprintf (stderr, argIndex == argc ? "No file name given.\n" : "Too many arguments.\n");
+            exit (1);
+        }
+        filein = fopen (argv[argIndex], "r");
+        if (filein == NULL) {
+            fprintf (stderr, "Can't open file: %s\n", argv[argIndex]);
+            exit (1);
+        }
+        Load (filein);
+        if (Lockstep (limit, &count)) {
+            exit (1);
+        }
+        printf ("No divergence in %ld instructions; stopped at %8.8x\n", count, mips.pc);
+        return 0;
+    }
+
+    for (n=0; n<programs; n++, seed++) {
+        progout = tmpfile ();
+        if (progout == NULL) {
+            fprintf (stderr, "Can't create temporary file.\n");
+            exit (1);
+        }
+        RandomProgram (seed, progout);
+        Load (progout);
+        if (Lockstep (limit, &count)) {
+            /* Keep the program so the difference can be replayed */
+            sprintf (name, "cosim-%u.dump", seed);
+            filein = fopen (name, "w");
+            rewind (progout);
+            while (filein != NULL && (c = getc (progout)) != EOF) {
+                putc (c, filein);
+            }
+            if (filein != NULL) {
+                fclose (filein);
+                printf ("Program saved in %s\n", name);
+            }
+            exit (1);
+        }
+        fclose (progout);
+        total += count;
+    }
+    printf ("No divergence in %u programs, %ld instructions\n", programs, total);
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "computer.h"
+#include "dataflow.h"
+
+unsigned int Fetch (int);
+
+/* Nonzero once DataflowStart() has been called; tested by Simulate() */
+int dataflowActive = 0;
+
+/* When a value becomes available and which dynamic instruction made it */
+typedef struct {
+    long long ready;
+    long long producer;		/* -1 for initial state */
+} Availability;
+
+/* One executed instruction, linked to the input that made it wait */
+typedef struct {
+    int pc;
+    long long parent;
+} DataflowRecord;
+
+static Availability regAvail[32];
+static Availability memAvail[MAXNUMINSTRS+MAXNUMDATA];
+static DataflowRecord* history;
+static long long historySize;
+static int recording;
+static int reportAtExit;
+static long long count;
+static long long pathLength, pathEnd = -1;
+
+void DataflowStart () {
+    int k;
+
+    for (k=0; k<32; k++) {
+        regAvail[k].ready = 0;
+        regAvail[k].producer = -1;
+    }
+    for (k=0; k<MAXNUMINSTRS+MAXNUMDATA; k++) {
+        memAvail[k].ready = 0;
+        memAvail[k].producer = -1;
+    }
+    if (history == NULL) {
+        historySize = 4096;
+        history = malloc (historySize * sizeof (DataflowRecord));
+    }
+    recording = history != NULL;
+    dataflowActive = 1;
+    if (!reportAtExit) {
+        atexit (DataflowReport);
+        reportAtExit = 1;
+    }
+}
+
+/* Keep whichever of best and a arrives later */
+static void Later (Availability* best, Availability* a) {
+    if (a->ready > best->ready) {
+        *best = *a;
+    }
+}
+
+/*
+ *  Schedule one executed instruction. pc is its address and addr the
+ *  effective address of a lw or sw (ignored for anything else).
+ */
+void DataflowInstruction (DecodedInstr* d, int pc, int addr) {
+    Availability in = { 0, -1 };
+    int src1 = 0, src2 = 0, dest = 0, load = 0, store = 0;
+    int mem = (addr - 0x00400000)/4;
+
+    if (d->type == R) {
+        src1 = d->regs.r.rs;
+        src2 = d->regs.r.rt;
+        dest = d->regs.r.funct == 0x08 ? 0 : d->regs.r.rd;	/* jr */
+    } else if (d->type == I) {
+        load = d->op == 0x23;
+        store = d->op == 0x2b;
+        src1 = d->op == 0xf ? 0 : d->regs.i.rs;			/* lui */
+        if (store || d->op == 0x4 || d->op == 0x5) {
+            src2 = d->regs.i.rt;				/* sw, beq, bne */
+        } else {
+            dest = d->regs.i.rt;
+        }
+    } else if (d->op == 0x3) {
+        dest = 31;						/* jal */
+    }
+    if (mem < 0 || mem >= MAXNUMINSTRS+MAXNUMDATA) {
+        load = store = 0;
+    }
+
+    /* $0 is a constant, so it never delays anything */
+    if (src1 != 0) {
+        Later (&in, &regAvail[src1]);
+    }
+    if (src2 != 0) {
+        Later (&in, &regAvail[src2]);
+    }
+    if (load) {
+        Later (&in, &memAvail[mem]);
+    }
+    in.ready++;
+
+    if (dest != 0) {
+        regAvail[dest].ready = in.ready;
+        regAvail[dest].producer = count;
+    }
+    if (store) {
+        memAvail[mem].ready = in.ready;
+        memAvail[mem].producer = count;
+    }
+
+    if (recording) {
+        if (count == historySize) {
+            DataflowRecord* grown = historySize < DATAFLOW_MAX_RECORDS
+                ? realloc (history, 2*historySize * sizeof (DataflowRecord)) : NULL;
+            if (grown == NULL) {
+                free (history);
+            }
+            history = grown;
+            historySize *= 2;
+        }
+        if (history == NULL) {
+            /* Out of room: keep timing, stop recording the path */
+            recording = 0;
+        } else {
+            history[count].pc = pc;
+            history[count].parent = in.producer;
+        }
+    }
+
+    if (in.ready > pathLength) {
+        pathLength = in.ready;
+        pathEnd = count;
+    }
+    count++;
+}
+
+static int ByCount (const void* a, const void* b) {
+    return ((int*)b)[1] - ((int*)a)[1];
+}
+
+void DataflowReport () {
+    int (*onPath)[2];		/* static instruction index, occurrences */
+    long long k;
+    int n, top;
+
+    if (!dataflowActive || count == 0) {
+        return;
+    }
+
+    printf ("\nDataflow limit study\n");
+    printf ("  instructions          %lld\n", count);
+    printf ("  critical path length  %lld cycles\n", pathLength);
+    printf ("  ideal IPC             %.3f\n", (double) count / pathLength);
+
+    if (!recording) {
+        printf ("  (run too long to record the critical path)\n");
+        return;
+    }
+
+    /* Walk the path back from its last instruction, counting each pc */
+    onPath = calloc (MAXNUMINSTRS+MAXNUMDATA, sizeof (*onPath));
+    for (n=0; n<MAXNUMINSTRS+MAXNUMDATA; n++) {
+        onPath[n][0] = n;
+    }
+    for (k = pathEnd; k >= 0; k = history[k].parent) {
+        onPath[(history[k].pc - 0x00400000)/4][1]++;
+    }
+    qsort (onPath, MAXNUMINSTRS+MAXNUMDATA, sizeof (*onPath), ByCount);
+
+    printf ("  instructions on the critical path:\n");
+    printf ("    ADDR      INSTR     COUNT\n");
+    for (top=0; top<DATAFLOW_TOP && onPath[top][1] > 0; top++) {
+        n = 0x00400000 + 4*onPath[top][0];
+        printf ("    %8.8x  %8.8x  %d\n", n, Fetch (n), onPath[top][1]);
+    }
+    free (onPath);
+}
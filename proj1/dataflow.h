@@ -0,0 +1,18 @@
+
+/*
+ *  Dataflow limit study. While Simulate() runs, every instruction is
+ *  placed at the earliest cycle its register and memory inputs allow,
+ *  as if the machine had unlimited resources, unit latency and perfect
+ *  branch prediction. At exit the length of the critical path, the
+ *  resulting ideal IPC and the instructions that make up the critical
+ *  path are reported.
+ */
+
+#define DATAFLOW_MAX_RECORDS (1<<24)	/* dynamic instructions kept for the path */
+#define DATAFLOW_TOP 20			/* static instructions listed in the report */
+
+extern int dataflowActive;
+
+void DataflowStart ();
+void DataflowInstruction (DecodedInstr* d, int pc, int addr);
+void DataflowReport ();
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "computer.h"
+#include "event.h"
+#undef mips			/* gcc already has a def for mips */
+
+extern Computer mips;
+
+/* Nonzero once EventStart() has been called; tested by Simulate() */
+int eventActive = 0;
+
+static EventHandler handlers[EVENT_NUM_TYPES];
+static Event* wheelHead[EVENT_WHEEL_SIZE];
+static Event* wheelTail[EVENT_WHEEL_SIZE];
+static long long onWheel;		/* events in wheel slots */
+static Event* overflow;			/* events beyond the wheel, unordered */
+static Event* freeEvents;
+static long long now;			/* first cycle not yet run */
+static long long latest;		/* latest cycle anything was posted for */
+static long long cycle;			/* cycle the next instruction is fetched in */
+static long long handled[EVENT_NUM_TYPES];
+static long long pooled;
+static clock_t started;
+
+static char* typeNames[EVENT_NUM_TYPES] = { "fetch", "memory", "writeback" };
+
+void EventStart () {
+    eventActive = 1;
+    started = clock ();
+    atexit (EventReport);
+}
+
+/* Call handler for every event of the given type; NULL ignores them */
+void EventHandle (EventType type, EventHandler handler) {
+    handlers[type] = handler;
+}
+
+/* Take an event from the pool, growing the pool if it is empty */
+Event* EventNew (EventType type) {
+    Event* e;
+    int k;
+
+    if (freeEvents == NULL) {
+        e = malloc (EVENT_POOL_BLOCK * sizeof (Event));
+        if (e == NULL) {
+            fprintf (stderr, "Can't allocate memory for events.\n");
+            exit (1);
+        }
+        for (k=0; k<EVENT_POOL_BLOCK; k++) {
+            e[k].next = freeEvents;
+            freeEvents = &e[k];
+        }
+        pooled += EVENT_POOL_BLOCK;
+    }
+    e = freeEvents;
+    freeEvents = e->next;
+    e->type = type;
+    e->pc = e->addr = e->reg = e->value = 0;
+    return e;
+}
+
+static void Append (Event* e) {
+    int slot = e->time & (EVENT_WHEEL_SIZE-1);
+
+    e->next = NULL;
+    if (wheelHead[slot] == NULL) {
+        wheelHead[slot] = e;
+    } else {
+        wheelTail[slot]->next = e;
+    }
+    wheelTail[slot] = e;
+    onWheel++;
+}
+
+/* Schedule e for the given cycle; a cycle already run means now */
+void EventPost (Event* e, long long time) {
+    e->time = time < now ? now : time;
+    if (e->time > latest) {
+        latest = e->time;
+    }
+    if (e->time - now < EVENT_WHEEL_SIZE) {
+        Append (e);
+    } else {
+        e->next = overflow;
+        overflow = e;
+    }
+}
+
+long long EventNow () {
+    return now;
+}
+
+/* Move the overflow events the wheel now reaches onto it */
+static void Refill () {
+    Event **link = &overflow, *e;
+
+    while ((e = *link) != NULL) {
+        if (e->time - now < EVENT_WHEEL_SIZE) {
+            *link = e->next;
+            Append (e);
+        } else {
+            link = &e->next;
+        }
+    }
+}
+
+/* Run every event due up to and including the given cycle */
+void EventRunUntil (long long time) {
+    Event* e;
+    Event* next;
+    int slot;
+
+    while (now <= time) {
+        if (onWheel == 0) {
+            /* Nothing close: skip straight to the next event, if any */
+            next = overflow;
+            for (e = overflow; e != NULL; e = e->next) {
+                if (e->time < next->time) {
+                    next = e;
+                }
+            }
+            if (next == NULL || next->time > time) {
+                now = time+1;
+                Refill ();
+                return;
+            }
+            now = next->time;
+            Refill ();
+        }
+
+        slot = now & (EVENT_WHEEL_SIZE-1);
+        while ((e = wheelHead[slot]) != NULL) {
+            wheelHead[slot] = e->next;
+            onWheel--;
+            handled[e->type]++;
+            if (handlers[e->type] != NULL) {
+                handlers[e->type] (e);
+            }
+            e->next = freeEvents;
+            freeEvents = e;
+        }
+
+        now++;
+        if ((now & (EVENT_WHEEL_SIZE-1)) == 0 && overflow != NULL) {
+            Refill ();
+        }
+    }
+}
+
+/*
+ *  Post the events for one executed instruction and run everything due
+ *  by the cycle it was fetched in. pc is its address and addr the
+ *  effective address of a lw or sw (ignored for anything else).
+ */
+void EventInstruction (DecodedInstr* d, int pc, int addr) {
+    Event* e;
+    int dest = 0, memory = 0;
+
+    if (d->type == R) {
+        dest = d->regs.r.funct == 0x08 ? 0 : d->regs.r.rd;		/* jr */
+    } else if (d->type == I) {
+        memory = d->op == 0x23 || d->op == 0x2b;			/* lw, sw */
+        if (d->op != 0x2b && d->op != 0x4 && d->op != 0x5) {
+            dest = d->regs.i.rt;					/* not sw, beq, bne */
+        }
+    } else if (d->op == 0x3) {
+        dest = 31;							/* jal */
+    }
+
+    e = EventNew (EVENT_FETCH);
+    e->pc = e->addr = pc;
+    e->value = mips.memory[(pc-0x00400000)/4];
+    EventPost (e, cycle);
+
+    if (memory) {
+        e = EventNew (EVENT_MEMORY);
+        e->pc = pc;
+        e->addr = addr;
+        e->value = ValidAddress (addr) ? mips.memory[(addr-0x00400000)/4] : 0;
+        EventPost (e, cycle + EVENT_MEMORY_STAGE);
+    }
+    if (dest != 0) {
+        e = EventNew (EVENT_WRITEBACK);
+        e->pc = pc;
+        e->reg = dest;
+        e->value = mips.registers[dest];
+        EventPost (e, cycle + EVENT_WRITEBACK_STAGE);
+    }
+
+    EventRunUntil (cycle);
+    cycle++;
+}
+
+void EventReport () {
+    long long total = 0;
+    double seconds;
+    int k;
+
+    if (!eventActive) {
+        return;
+    }
+    EventRunUntil (latest);
+    seconds = (double) (clock () - started) / CLOCKS_PER_SEC;
+
+    printf ("\nEvent kernel\n");
+    printf ("  cycles            %lld\n", now);
+    for (k=0; k<EVENT_NUM_TYPES; k++) {
+        printf ("  %-10s events  %lld\n", typeNames[k], handled[k]);
+        total += handled[k];
+    }
+    printf ("  pooled events     %lld\n", pooled);
+    if (seconds > 0) {
+        printf ("  events per second %.0f\n", total / seconds);
+    }
+}
@@ -0,0 +1,48 @@
+
+/*
+ *  Discrete-event kernel for timing models. Events are kept on a timing
+ *  wheel of EVENT_WHEEL_SIZE one-cycle slots; events further out than
+ *  the wheel reaches wait on an overflow list until the wheel comes
+ *  round to them. Event objects come from a pool that only grows, so
+ *  posting an event never calls malloc once the pool is big enough.
+ *
+ *  Each event type has one handler, called when simulated time reaches
+ *  the event. Events due in the same cycle run in the order they were
+ *  posted. A handler may post more events, including ones for the
+ *  current cycle; the event it was given is recycled when it returns.
+ *
+ *  While Simulate() runs with the kernel started, instruction n is
+ *  fetched in cycle n and posts a fetch event then, a memory event
+ *  EVENT_MEMORY_STAGE cycles later if it is a lw or sw, and a writeback
+ *  event EVENT_WRITEBACK_STAGE cycles later if it writes a register.
+ */
+
+#define EVENT_WHEEL_SIZE 4096		/* power of two */
+#define EVENT_POOL_BLOCK 4096		/* events allocated at a time */
+#define EVENT_MEMORY_STAGE 3
+#define EVENT_WRITEBACK_STAGE 4
+
+typedef enum { EVENT_FETCH=0, EVENT_MEMORY, EVENT_WRITEBACK, EVENT_NUM_TYPES } EventType;
+
+typedef struct Event {
+    long long time;		/* cycle the event happens in */
+    EventType type;
+    int pc;			/* instruction that caused it */
+    int addr;			/* address fetched or accessed */
+    int reg;			/* register written back */
+    int value;			/* value stored, loaded or written back */
+    struct Event* next;
+} Event;
+
+typedef void (*EventHandler) (Event* e);
+
+extern int eventActive;
+
+void EventStart ();
+void EventHandle (EventType type, EventHandler handler);
+Event* EventNew (EventType type);
+void EventPost (Event* e, long long time);
+long long EventNow ();
+void EventRunUntil (long long time);
+void EventInstruction (DecodedInstr* d, int pc, int addr);
+void EventReport ();
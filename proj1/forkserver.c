@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "computer.h"
+#include "trace.h"
+#include "console.h"
+#include "forkserver.h"
+#undef mips			/* gcc already has a def for mips */
+
+extern Computer mips;
+
+/* Shared with the children, which fill it in as they run */
+static ForkResponse* result;
+static long forkLimit;
+
+/* Read or write all of n bytes, returning 0, or -1 at end of file */
+static int ReadAll (int fd, void* buf, size_t n) {
+    ssize_t got;
+
+    while (n > 0) {
+        got = read (fd, buf, n);
+        if (got <= 0) {
+            return -1;
+        }
+        buf = (char*) buf + got;
+        n -= got;
+    }
+    return 0;
+}
+
+static int WriteAll (int fd, const void* buf, size_t n) {
+    ssize_t put;
+
+    while (n > 0) {
+        put = write (fd, buf, n);
+        if (put <= 0) {
+            return -1;
+        }
+        buf = (const char*) buf + put;
+        n -= put;
+    }
+    return 0;
+}
+
+/*
+ *  Give the loaded program its input, then run it. Never returns. The
+ *  child writes nothing: the console and trace are off, and it leaves
+ *  with _exit() so the atexit handlers it inherited (trace flush, timing
+ *  reports) stay the parent's.
+ */
+static void RunChild (int* input, int words) {
+    int null = open ("/dev/null", O_RDWR), k, pc;
+    StepResult stop = STEP_OK;
+
+    dup2 (null, 0);
+    dup2 (null, 1);
+    mips.quiet = 1;
+    traceActive = 0;
+    ConsoleAttach (NULL, NULL);
+    for (k=0; k<words && k<4; k++) {
+        mips.registers[4+k] = input[k];
+    }
+    for (k=4; k<words; k++) {
+        mips.memory[MAXNUMINSTRS+k-4] = input[k];
+    }
+
+    while (result->executed < forkLimit && stop == STEP_OK) {
+        pc = mips.pc;
+        stop = Step ();
+        if (stop == STEP_OK) {
+            k = (pc-0x00400000)/4;
+            if (k >= 0 && k < MAXNUMINSTRS && result->coverage[k] < 255) {
+                result->coverage[k]++;
+            }
+            result->executed++;
+        }
+    }
+
+    if (stop == STEP_FAULT) {
+        result->status = FORK_FAULT;
+    } else if (stop == STEP_HALTED && mips.exited) {
+        result->status = FORK_EXITED;
+        result->exitCode = mips.exitCode;
+    } else if (stop == STEP_HALTED) {
+        result->status = FORK_HALTED;
+    } else {
+        result->status = FORK_TIMEOUT;
+    }
+    memcpy (result->registers, mips.registers, sizeof (result->registers));
+    _exit (0);
+}
+
+/*
+ *  Serve requests until stdin is closed, allowing each run at most
+ *  limit instructions. Call after InitComputer(). Returns 0 at end of
+ *  input, or -1 if a child can't be started or the response can't be
+ *  written.
+ */
+int ForkServer (long limit) {
+    static int input[FORK_MAX_INPUT/4];
+    unsigned int length;
+    int status, k;
+    pid_t child;
+
+    result = mmap (NULL, sizeof (ForkResponse), PROT_READ|PROT_WRITE,
+        MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if (result == MAP_FAILED) {
+        return -1;
+    }
+    forkLimit = limit;
+
+    /* Decode the text once here rather than again in every child */
+    for (k=0; k<MAXNUMINSTRS; k++) {
+        if (ValidInstr (mips.memory[k])) {
+            Predecode (0x00400000 + 4*k);
+        }
+    }
+    fflush (stdout);
+
+    while (ReadAll (0, &length, 4) == 0) {
+        if (length > FORK_MAX_INPUT || ReadAll (0, input, length) != 0) {
+            return -1;
+        }
+        memset ((char*) input + length, 0, (4 - length%4) % 4);
+        memset (result, 0, sizeof (ForkResponse));
+        result->status = FORK_CRASHED;	/* until the child says otherwise */
+
+        child = fork ();
+        if (child < 0) {
+            return -1;
+        } else if (child == 0) {
+            RunChild (input, (length+3)/4);
+        }
+        waitpid (child, &status, 0);
+
+        if (WIFSIGNALED (status)) {
+            result->status = FORK_CRASHED;
+            result->signal = WTERMSIG (status);
+        }
+        if (WriteAll (1, result, sizeof (ForkResponse)) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
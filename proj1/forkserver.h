@@ -0,0 +1,37 @@
+
+/*
+ *  Fork server for fuzzing. The program is loaded and predecoded once;
+ *  then each request read from stdin is run in a fork()ed child of the
+ *  loaded simulator, and a response describing the run is written to
+ *  stdout. The children's stdin and stdout are /dev/null. A child runs
+ *  the program a Step() at a time and records how it stopped in the
+ *  response itself, so its exit status carries nothing.
+ *
+ *  Request: a 4-byte length in host byte order, then that many bytes
+ *  of input (at most FORK_MAX_INPUT). The input is read as host-order
+ *  words: the first four become $a0-$a3 and the rest are stored from
+ *  the start of the data segment on. Missing words stay as loaded.
+ *
+ *  Response: one ForkResponse, in host byte order.
+ */
+
+#define FORK_MAX_INPUT (4*(4+MAXNUMDATA))
+
+typedef enum {
+    FORK_HALTED=0,		/* stopped at an unimplemented instruction */
+    FORK_FAULT,			/* memory access exception or unknown syscall */
+    FORK_TIMEOUT,		/* ran the most instructions allowed */
+    FORK_CRASHED,		/* the simulator itself died */
+    FORK_EXITED			/* the program ran exit or exit2 */
+} ForkStatus;
+
+typedef struct {
+    int status;			/* ForkStatus */
+    int signal;			/* what killed a crashed child, otherwise 0 */
+    int exitCode;		/* given to exit or exit2, otherwise 0 */
+    long long executed;
+    int registers[32];		/* at the end of the run, unless crashed */
+    unsigned char coverage[MAXNUMINSTRS];	/* saturating count per text word */
+} ForkResponse;
+
+int ForkServer (long limit);
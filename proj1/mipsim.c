@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "computer.h"
+#include "console.h"
+#include "mipsim.h"
+#undef mips			/* gcc already has a def for mips */
+
+extern Computer mips;
+
+struct Mipsim {
+    Computer computer;		/* saved while another simulator is resident */
+    int loaded;
+    long long executed;
+    MipsimStatus status;
+    FILE* in;			/* the program's console, NULL for none */
+    FILE* out;
+};
+
+/* The simulator whose state is in mips */
+static Mipsim* resident;
+
+/* Make sim the one the simulator core works on. */
+static void Reside (Mipsim* sim) {
+    if (resident == sim) {
+        return;
+    }
+    if (resident != NULL) {
+        resident->computer = mips;
+    }
+    mips = sim->computer;
+    FlushDecodeCache ();
+    ConsoleAttach (sim->in, sim->out);
+    resident = sim;
+}
+
+/* Create a simulator with no program, or return NULL if out of memory. */
+Mipsim* MipsimCreate () {
+    Mipsim* sim = calloc (1, sizeof (Mipsim));
+
+    if (sim == NULL) {
+        return NULL;
+    }
+    sim->computer.memory = NewMemory ();
+    if (sim->computer.memory == NULL) {
+        free (sim);
+        return NULL;
+    }
+    sim->computer.quiet = 1;
+    sim->status = MIPSIM_NOT_LOADED;
+    return sim;
+}
+
+/*
+ *  Load the .dump file at path, resetting registers and memory as the
+ *  sim command does. On failure the simulator has no program.
+ */
+MipsimStatus MipsimLoad (Mipsim* sim, const char* path) {
+    FILE* filein = fopen (path, "r");
+
+    if (filein == NULL) {
+        return MIPSIM_CANT_OPEN;
+    }
+    Reside (sim);
+    sim->loaded = LoadComputer (filein) == 0;
+    fclose (filein);
+    sim->executed = 0;
+    sim->status = sim->loaded ? MIPSIM_OK : MIPSIM_NOT_LOADED;
+    return sim->loaded ? MIPSIM_OK : MIPSIM_TOO_BIG;
+}
+
+/*
+ *  Run until stop is the pc, the program halts or faults, or limit
+ *  instructions have run. stop is -1 to run until one of the others.
+ */
+static MipsimStatus Run (Mipsim* sim, int stop, long limit) {
+    StepResult result = STEP_OK;
+    long n;
+
+    if (!sim->loaded) {
+        return MIPSIM_NOT_LOADED;
+    }
+    Reside (sim);
+    for (n=0; n<limit && mips.pc != stop; n++) {
+        result = Step ();
+        if (result != STEP_OK) {
+            break;
+        }
+    }
+    sim->executed += n;
+    ConsoleFlush ();
+    if (result == STEP_HALTED) {
+        sim->status = MIPSIM_HALTED;
+    } else if (result == STEP_FAULT) {
+        sim->status = MIPSIM_FAULT;
+    } else if (mips.pc == stop || stop == -1) {
+        sim->status = MIPSIM_OK;
+    } else {
+        sim->status = MIPSIM_LIMIT;
+    }
+    return sim->status;
+}
+
+/*
+ *  Execute n instructions. Returns MIPSIM_OK if all of them ran, or
+ *  MIPSIM_HALTED or MIPSIM_FAULT at the instruction that stopped it,
+ *  which is left unexecuted.
+ */
+MipsimStatus MipsimStep (Mipsim* sim, long n) {
+    return Run (sim, -1, n);
+}
+
+/*
+ *  Execute until the next instruction is the one at pc, returning
+ *  MIPSIM_OK, or MIPSIM_LIMIT if it isn't reached in limit
+ *  instructions. Stops early if the program halts or faults.
+ */
+MipsimStatus MipsimRunUntil (Mipsim* sim, int pc, long limit) {
+    return Run (sim, pc, limit);
+}
+
+void MipsimGetState (Mipsim* sim, MipsimState* state) {
+    Computer* c = sim == resident ? &mips : &sim->computer;
+    int k;
+
+    state->pc = c->pc;
+    for (k=0; k<32; k++) {
+        state->registers[k] = c->registers[k];
+    }
+    state->executed = sim->executed;
+    state->status = sim->status;
+    state->exited = c->exited;
+    state->exitCode = c->exitCode;
+}
+
+/*
+ *  Give the program console input from in and output to out. Without
+ *  them, or with NULL, input is at end of file and output is dropped.
+ *  Output is flushed at the end of every step or run.
+ */
+void MipsimSetConsole (Mipsim* sim, FILE* in, FILE* out) {
+    sim->in = in;
+    sim->out = out;
+    if (sim == resident) {
+        ConsoleAttach (in, out);
+    }
+}
+
+/* Set a register, for giving a program its inputs. $0 stays zero. */
+MipsimStatus MipsimSetRegister (Mipsim* sim, int reg, int value) {
+    if (reg < 0 || reg > 31) {
+        return MIPSIM_BAD_ARGUMENT;
+    }
+    Reside (sim);
+    mips.registers[reg] = reg == 0 ? 0 : value;
+    return MIPSIM_OK;
+}
+
+MipsimStatus MipsimReadWord (Mipsim* sim, int addr, int* value) {
+    if (!ValidAddress (addr)) {
+        return MIPSIM_BAD_ARGUMENT;
+    }
+    Reside (sim);
+    *value = mips.memory[(addr-0x00400000)/4];
+    return MIPSIM_OK;
+}
+
+MipsimStatus MipsimWriteWord (Mipsim* sim, int addr, int value) {
+    if (!ValidAddress (addr)) {
+        return MIPSIM_BAD_ARGUMENT;
+    }
+    Reside (sim);
+    mips.memory[(addr-0x00400000)/4] = value;
+    if (addr < 0x00400000 + 4*MAXNUMINSTRS) {
+        FlushDecodeCache ();
+    }
+    return MIPSIM_OK;
+}
+
+void MipsimDestroy (Mipsim* sim) {
+    if (sim == NULL) {
+        return;
+    }
+    if (sim == resident) {
+        resident = NULL;
+        mips.memory = NULL;
+    }
+    FreeMemory (sim->computer.memory);
+    free (sim);
+}
@@ -0,0 +1,49 @@
+
+/*
+ *  libmipsim: the simulator as a library, for running programs in the
+ *  calling process. Nothing here prints or exits; every call reports
+ *  through a MipsimStatus instead, and a program's console reads and
+ *  writes only the streams given to MipsimSetConsole().
+ *
+ *  Any number of simulators can exist at once, but they share the one
+ *  simulator core, so they must all be used from the same thread.
+ *  Switching between them costs a decode cache flush. Each has its own
+ *  registers, memory, sbrk break (reset by MipsimLoad()) and console
+ *  streams; console output is flushed before another simulator runs,
+ *  so it never reaches the wrong stream.
+ */
+
+typedef enum {
+    MIPSIM_OK = 0,
+    MIPSIM_HALTED,		/* at an instruction that isn't implemented,
+				   or an exit syscall */
+    MIPSIM_FAULT,		/* at a load or store outside memory, or an
+				   unknown syscall */
+    MIPSIM_LIMIT,		/* ran the most instructions it was allowed */
+    MIPSIM_NOT_LOADED,		/* no program has been loaded */
+    MIPSIM_CANT_OPEN,		/* the dump file can't be read */
+    MIPSIM_TOO_BIG,		/* the program doesn't fit in memory */
+    MIPSIM_BAD_ARGUMENT		/* register number or address out of range */
+} MipsimStatus;
+
+typedef struct {
+    int pc;
+    int registers[32];
+    long long executed;		/* instructions since the program was loaded */
+    MipsimStatus status;	/* why the last step or run stopped */
+    int exited;			/* nonzero once the program ran exit or exit2 */
+    int exitCode;		/* the status it gave them */
+} MipsimState;
+
+typedef struct Mipsim Mipsim;
+
+Mipsim* MipsimCreate ();
+MipsimStatus MipsimLoad (Mipsim* sim, const char* path);
+MipsimStatus MipsimStep (Mipsim* sim, long n);
+MipsimStatus MipsimRunUntil (Mipsim* sim, int pc, long limit);
+void MipsimGetState (Mipsim* sim, MipsimState* state);
+void MipsimSetConsole (Mipsim* sim, FILE* in, FILE* out);
+MipsimStatus MipsimSetRegister (Mipsim* sim, int reg, int value);
+MipsimStatus MipsimReadWord (Mipsim* sim, int addr, int* value);
+MipsimStatus MipsimWriteWord (Mipsim* sim, int addr, int value);
+void MipsimDestroy (Mipsim* sim);
@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "computer.h"
+#include "ooo.h"
+
+/* Nonzero once OooConfigure() succeeds; tested by Simulate() */
+int oooActive = 0;
+
+static OooConfig config = {
+    4, 4, 4, 128, 32,
+    { 2, 1, 1, 1 },		/* ALU, branch, load, store units */
+    { 1, 1, 3, 1 }		/* and their latencies */
+};
+
+/* Resources whose utilization is reported; the busiest is the limit */
+typedef enum { USE_FETCH=0, USE_DISPATCH, USE_ROB, USE_RS, USE_COMMIT,
+    USE_UNITS, NUM_USES=USE_UNITS+OOO_NUM_CLASSES } OooUse;
+
+static char* useNames[NUM_USES] = {
+    "fetch", "dispatch", "reorder buffer", "reservation stations",
+    "commit", "alu units", "branch units", "load units", "store units"
+};
+
+static char* classNames[OOO_NUM_CLASSES] = { "alu", "branch", "load", "store" };
+
+/* Per-instruction history, indexed by instruction number mod OOO_MAX_ROB */
+static long long dispatchTime[OOO_MAX_ROB];
+static long long commitTime[OOO_MAX_ROB];
+
+static long long regReady[32];
+static long long memReady[MAXNUMINSTRS+MAXNUMDATA];
+static long long rsFree[OOO_MAX_ROB];
+
+/*
+ *  Unit bookings, a ring indexed by cycle mod window. Bookings before
+ *  the latest dispatch are never looked at again, and none is more than
+ *  robSize * (latency + 2) cycles after it: the ROB's instructions can
+ *  each wait out a latency and a busy unit. So a ring that long never
+ *  mixes up two cycles still in use.
+ */
+static long long* unitCycle[OOO_NUM_CLASSES];
+static int* unitCount[OOO_NUM_CLASSES];
+static long long window;
+
+static long long fetchCycle;
+static int fetchSlots, fetchBreak;
+static long long count;
+static long long fetchGroups;		/* cycles in which fetch delivered */
+static long long robOccupancy;		/* entry-cycles spent in the ROB */
+static long long rsOccupancy;		/* entry-cycles spent waiting to issue */
+static long long classCount[OOO_NUM_CLASSES];
+static int reportAtExit;
+
+/*
+ *  Parse a comma separated list of key=value settings, e.g.
+ *  "fetch=8,issue=8,rob=256,rs=64,load=2,load-lat=4", on top of the
+ *  defaults above. "default" keeps the defaults. Returns 0 on success,
+ *  -1 for an unknown key or out of range value.
+ */
+int OooConfigure (const char* options) {
+    char buffer[200], *key, *value;
+    int k, n, found, longest;
+
+    strncpy (buffer, options, sizeof (buffer)-1);
+    buffer[sizeof (buffer)-1] = '\0';
+
+    for (key = strtok (buffer, ","); key != NULL; key = strtok (NULL, ",")) {
+        if (strcmp (key, "default") == 0) {
+            continue;
+        }
+        value = strchr (key, '=');
+        if (value == NULL) {
+            return -1;
+        }
+        *value++ = '\0';
+        n = atoi (value);
+        if (n < 1) {
+            return -1;
+        }
+
+        found = 1;
+        if (strcmp (key, "fetch") == 0) {
+            config.fetchWidth = n;
+        } else if (strcmp (key, "issue") == 0) {
+            config.issueWidth = n;
+        } else if (strcmp (key, "commit") == 0) {
+            config.commitWidth = n;
+        } else if (strcmp (key, "rob") == 0) {
+            config.robSize = n;
+        } else if (strcmp (key, "rs") == 0) {
+            config.rsSize = n;
+        } else {
+            found = 0;
+        }
+        for (k=0; k<OOO_NUM_CLASSES && !found; k++) {
+            if (strcmp (key, classNames[k]) == 0) {
+                config.units[k] = n;
+                found = 1;
+            } else if (strncmp (key, classNames[k], strlen (classNames[k])) == 0
+                       && strcmp (key + strlen (classNames[k]), "-lat") == 0) {
+                config.latency[k] = n;
+                found = 1;
+            }
+        }
+        if (!found) {
+            return -1;
+        }
+    }
+
+    if (config.fetchWidth > OOO_MAX_WIDTH || config.issueWidth > OOO_MAX_WIDTH
+        || config.commitWidth > OOO_MAX_WIDTH || config.robSize > OOO_MAX_ROB
+        || config.rsSize > config.robSize) {
+        return -1;
+    }
+    longest = 0;
+    for (k=0; k<OOO_NUM_CLASSES; k++) {
+        if (config.latency[k] > OOO_MAX_LATENCY) {
+            return -1;
+        }
+        if (config.latency[k] > longest) {
+            longest = config.latency[k];
+        }
+    }
+
+    window = (long long) config.robSize * (longest + 2) + 1;
+    for (k=0; k<OOO_NUM_CLASSES; k++) {
+        free (unitCycle[k]);
+        free (unitCount[k]);
+        unitCycle[k] = malloc (window * sizeof (long long));
+        unitCount[k] = malloc (window * sizeof (int));
+        if (unitCycle[k] == NULL || unitCount[k] == NULL) {
+            return -1;
+        }
+        memset (unitCycle[k], -1, window * sizeof (long long));
+    }
+    oooActive = 1;
+    if (!reportAtExit) {
+        atexit (OooReport);
+        reportAtExit = 1;
+    }
+    return 0;
+}
+
+/* The class of functional unit that executes d */
+static OooClass Classify (DecodedInstr* d) {
+    if (d->type == J || (d->type == R && d->regs.r.funct == 0x08)) {
+        return OOO_BRANCH;	/* j, jal, jr */
+    }
+    if (d->type == I) {
+        switch (d->op) {
+        case 0x4: case 0x5: return OOO_BRANCH;	/* beq, bne */
+        case 0x23: return OOO_LOAD;		/* lw */
+        case 0x2b: return OOO_STORE;		/* sw */
+        }
+    }
+    return OOO_ALU;
+}
+
+/* Largest of n candidate times */
+static long long Latest (long long* times, int n) {
+    long long best = times[0];
+    int k;
+
+    for (k=1; k<n; k++) {
+        if (times[k] > best) {
+            best = times[k];
+        }
+    }
+    return best;
+}
+
+/* First cycle at or after t with a free unit of class c; books it */
+static long long BookUnit (OooClass c, long long t) {
+    int slot;
+
+    for (;; t++) {
+        slot = t % window;
+        if (unitCycle[c][slot] != t) {
+            unitCycle[c][slot] = t;
+            unitCount[c][slot] = 0;
+        }
+        if (unitCount[c][slot] < config.units[c]) {
+            unitCount[c][slot]++;
+            return t;
+        }
+    }
+}
+
+/*
+ *  Account for one executed instruction. pc is its address, nextPc the
+ *  address executed after it, and addr the effective address of a lw
+ *  or sw (ignored for anything else).
+ */
+void OooInstruction (DecodedInstr* d, int pc, int nextPc, int addr) {
+    OooClass c = Classify (d);
+    long long times[5], fetch, dispatch, issue, complete, commit;
+    int src1 = 0, src2 = 0, dest = 0, k, slot = 0;
+    int mem = (addr - 0x00400000)/4;
+
+    /* Fetch: fetchWidth per cycle, and a taken branch ends the group */
+    if (fetchSlots == config.fetchWidth || fetchBreak || count == 0) {
+        fetchCycle += count > 0;
+        fetchSlots = 0;
+        fetchGroups++;
+    }
+    fetch = fetchCycle;
+    fetchSlots++;
+    fetchBreak = nextPc != pc+4;
+
+    /* Dispatch in order into the ROB and the earliest free station */
+    for (k=1; k<config.rsSize; k++) {
+        if (rsFree[k] < rsFree[slot]) {
+            slot = k;
+        }
+    }
+    times[0] = fetch + 1;
+    times[1] = count > 0 ? dispatchTime[(count-1) % OOO_MAX_ROB] : 0;
+    times[2] = count >= config.issueWidth
+        ? dispatchTime[(count-config.issueWidth) % OOO_MAX_ROB] + 1 : 0;
+    times[3] = count >= config.robSize
+        ? commitTime[(count-config.robSize) % OOO_MAX_ROB] + 1 : 0;
+    times[4] = rsFree[slot];
+    dispatch = Latest (times, 5);
+
+    /* Issue once the operands are ready and a unit is free */
+    if (d->type == R) {
+        src1 = d->regs.r.rs;
+        src2 = d->regs.r.rt;
+        dest = d->regs.r.funct == 0x08 ? 0 : d->regs.r.rd;
+    } else if (d->type == I) {
+        src1 = d->op == 0xf ? 0 : d->regs.i.rs;		/* lui */
+        if (c == OOO_BRANCH || c == OOO_STORE) {
+            src2 = d->regs.i.rt;
+        } else {
+            dest = d->regs.i.rt;
+        }
+    } else if (d->op == 0x3) {
+        dest = 31;					/* jal */
+    }
+    times[0] = dispatch + 1;
+    times[1] = src1 ? regReady[src1] : 0;
+    times[2] = src2 ? regReady[src2] : 0;
+    times[3] = c == OOO_LOAD && mem >= 0 && mem < MAXNUMINSTRS+MAXNUMDATA
+        ? memReady[mem] : 0;
+    issue = BookUnit (c, Latest (times, 4));
+    rsFree[slot] = issue + 1;
+
+    complete = issue + config.latency[c];
+    if (dest != 0) {
+        regReady[dest] = complete;
+    }
+    if (c == OOO_STORE && mem >= 0 && mem < MAXNUMINSTRS+MAXNUMDATA) {
+        memReady[mem] = complete;
+    }
+
+    /* Commit in order, commitWidth per cycle */
+    times[0] = complete;
+    times[1] = count > 0 ? commitTime[(count-1) % OOO_MAX_ROB] : 0;
+    times[2] = count >= config.commitWidth
+        ? commitTime[(count-config.commitWidth) % OOO_MAX_ROB] + 1 : 0;
+    commit = Latest (times, 3);
+
+    dispatchTime[count % OOO_MAX_ROB] = dispatch;
+    commitTime[count % OOO_MAX_ROB] = commit;
+    robOccupancy += commit + 1 - dispatch;
+    rsOccupancy += issue + 1 - dispatch;
+    classCount[c]++;
+    count++;
+}
+
+/*
+ *  Print IPC and how busy each resource was. The busiest resource is
+ *  reported as the limit when it is close to saturated; otherwise the
+ *  program itself, through its data dependences, is the limit.
+ */
+void OooReport () {
+    double use[NUM_USES], cycles;
+    int k, worst = 0;
+
+    if (!oooActive || count == 0) {
+        return;
+    }
+    cycles = commitTime[(count-1) % OOO_MAX_ROB] + 1;
+
+    use[USE_FETCH] = fetchGroups / cycles;
+    use[USE_DISPATCH] = count / (cycles * config.issueWidth);
+    use[USE_ROB] = robOccupancy / (cycles * config.robSize);
+    use[USE_RS] = rsOccupancy / (cycles * config.rsSize);
+    use[USE_COMMIT] = count / (cycles * config.commitWidth);
+    for (k=0; k<OOO_NUM_CLASSES; k++) {
+        use[USE_UNITS+k] = classCount[k] / (cycles * config.units[k]);
+    }
+    for (k=1; k<NUM_USES; k++) {
+        if (use[k] > use[worst]) {
+            worst = k;
+        }
+    }
+
+    printf ("\nOut-of-order timing model\n");
+    printf ("  fetch %d, issue %d, commit %d, ROB %d, RS %d\n",
+        config.fetchWidth, config.issueWidth, config.commitWidth,
+        config.robSize, config.rsSize);
+    for (k=0; k<OOO_NUM_CLASSES; k++) {
+        printf ("  %-7s units %d, latency %d\n",
+            classNames[k], config.units[k], config.latency[k]);
+    }
+    printf ("  instructions %lld\n", count);
+    printf ("  cycles       %.0f\n", cycles);
+    printf ("  IPC          %.3f\n", count / cycles);
+    printf ("  utilization:\n");
+    for (k=0; k<NUM_USES; k++) {
+        printf ("    %-22s %5.1f%%\n", useNames[k], 100*use[k]);
+    }
+    printf ("  limited by %s\n",
+        use[worst] >= OOO_SATURATED ? useNames[worst] : "data dependences");
+}
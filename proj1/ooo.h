@@ -0,0 +1,32 @@
+
+/*
+ *  Out-of-order superscalar timing model. Simulate() hands every
+ *  executed instruction to OooInstruction() in program order, and the
+ *  model works out when a Tomasulo-style core would fetch, dispatch,
+ *  issue, complete and commit it, assuming perfect branch prediction and
+ *  register renaming. At exit it reports IPC and which resource held
+ *  the core back the most.
+ */
+
+#define OOO_MAX_WIDTH 16
+#define OOO_MAX_ROB 1024
+#define OOO_MAX_LATENCY 1024
+#define OOO_SATURATED 0.9	/* utilization at which a resource is the limit */
+
+typedef enum { OOO_ALU=0, OOO_BRANCH, OOO_LOAD, OOO_STORE, OOO_NUM_CLASSES } OooClass;
+
+typedef struct {
+    int fetchWidth;		/* instructions fetched per cycle */
+    int issueWidth;		/* instructions dispatched per cycle */
+    int commitWidth;		/* instructions retired per cycle */
+    int robSize;		/* reorder buffer entries */
+    int rsSize;			/* reservation stations, shared by all units */
+    int units [OOO_NUM_CLASSES];	/* pipelined functional units per class */
+    int latency [OOO_NUM_CLASSES];	/* cycles from issue to result */
+} OooConfig;
+
+extern int oooActive;
+
+int OooConfigure (const char* options);
+void OooInstruction (DecodedInstr* d, int pc, int nextPc, int addr);
+void OooReport ();
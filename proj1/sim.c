@@ -1,6 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "computer.h"
+#include "trace.h"
+#include "batch.h"
+#include "ooo.h"
+#include "dataflow.h"
+#include "watch.h"
+#include "forkserver.h"
+#include "event.h"
 
 #define TRUE 1
 #define FALSE 0
@@ -11,14 +18,20 @@ int main (int argc, char *argv[]) {
     int printingMemory = FALSE;
     int debugging = FALSE;
     int interactive = FALSE;
-    FILE *filein;
+    int quiet = FALSE;
+    int watching = FALSE;
+    long forkLimit = 0;
+    char *traceName = NULL;
+    TraceFormat traceFormat = TRACE_BINARY;
+    char *batchName = NULL;
+    FILE *filein, *states;
 
     if (argc < 2) {
         fprintf (stderr, "Not enough arguments.\n");
         exit (1);
     }
     for (argIndex=1; argIndex<argc && argv[argIndex][0]=='-'; argIndex++) {
-        /* Argument is an option, we hope one of -r, -m, -i, -d. */
+        /* Argument is an option, we hope one of -r, -m, -i, -d, -q, -t, -T, -b, -o, -l, -w, -W, -f, -e. */
         switch (argv[argIndex][1]) {
             case 'r':
             printingRegisters = TRUE;
@@ -32,9 +45,75 @@ int main (int argc, char *argv[]) {
             case 'd':
             debugging = TRUE;
             break;
+            case 'q':
+            quiet = TRUE;
+            break;
+            case 't':
+            case 'T':
+            /* -t <file> writes a binary trace, -T <file> a din trace */
+            if (argIndex+1 >= argc) {
+                fprintf (stderr, "No trace file name given.\n");
+                exit (1);
+            }
+            traceFormat = argv[argIndex][1] == 't' ? TRACE_BINARY : TRACE_DIN;
+            traceName = argv[++argIndex];
+            break;
+            case 'b':
+            /* -b <file> runs one instance per line of initial $a0-$a3 */
+            if (argIndex+1 >= argc) {
+                fprintf (stderr, "No state file name given.\n");
+                exit (1);
+            }
+            batchName = argv[++argIndex];
+            break;
+            case 'w':
+            case 'W':
+            /* -w <addr> reports changes to a word, -W <addr> also halts */
+            if (argIndex+1 >= argc) {
+                fprintf (stderr, "No watchpoint address given.\n");
+                exit (1);
+            }
+            if (WatchAdd (strtoul (argv[argIndex+1], NULL, 16),
+                          argv[argIndex][1] == 'W') != 0) {
+                fprintf (stderr, "Invalid watchpoint address \"%s\".\n", argv[argIndex+1]);
+                exit (1);
+            }
+            argIndex++;
+            watching = TRUE;
+            break;
+            case 'f':
+            /* -f <limit> serves fuzzing requests, see forkserver.h */
+            if (argIndex+1 >= argc) {
+                fprintf (stderr, "No instruction limit given.\n");
+                exit (1);
+            }
+            forkLimit = strtol (argv[++argIndex], NULL, 0);
+            if (forkLimit <= 0) {
+                fprintf (stderr, "Invalid instruction limit \"%s\".\n", argv[argIndex]);
+                exit (1);
+            }
+            break;
+            case 'e':
+            EventStart ();
+            break;
+            case 'l':
+            DataflowStart ();
+            break;
+            case 'o':
+            /* -o <options> enables the out-of-order timing model */
+            if (argIndex+1 >= argc) {
+                fprintf (stderr, "No timing model options given.\n");
+                exit (1);
+            }
+            if (OooConfigure (argv[++argIndex]) != 0) {
+                fprintf (stderr, "Invalid timing model options \"%s\".\n", argv[argIndex]);
+                exit (1);
+            }
+            break;
             default:
             fprintf (stderr, "Invalid option \"%s\".\n", argv[argIndex]);
-            fprintf (stderr, "Correct options are -r, -m, -i, -d.\n");
+            fprintf (stderr, "Correct options are -r, -m, -i, -d, -q, -t <file>, -T <file>,\n");
+            fprintf (stderr, "-b <file>, -o <key=value,...>, -l, -w <addr>, -W <addr>, -f <limit>, -e.\n");
             exit (1);
         }
     }
@@ -52,8 +131,37 @@ int main (int argc, char *argv[]) {
         exit (1);
     }
     
+    if (batchName != NULL) {
+        states = fopen (batchName, "r");
+        if (states == NULL) {
+            fprintf (stderr, "Can't open file: %s\n", batchName);
+            exit (1);
+        }
+        if (BatchSimulate (filein, states) != 0) {
+            fprintf (stderr, "Program too big.\n");
+            exit (1);
+        }
+        return 0;
+    }
+
+    if (traceName != NULL && TraceOpen (traceName, traceFormat) != 0) {
+        fprintf (stderr, "Can't open trace file: %s\n", traceName);
+        exit (1);
+    }
+
     InitComputer (filein, printingRegisters, printingMemory,
-	debugging, interactive);
+	debugging, interactive, quiet);
+    if (watching && WatchStart () != 0) {
+        fprintf (stderr, "Can't set watchpoints.\n");
+        exit (1);
+    }
+    if (forkLimit > 0) {
+        if (ForkServer (forkLimit) != 0) {
+            fprintf (stderr, "Fork server failed.\n");
+            exit (1);
+        }
+        return 0;
+    }
     Simulate ();
     return 0;
 }
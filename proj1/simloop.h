@@ -0,0 +1,145 @@
+
+/*
+ *  Body of one specialized simulation loop. computer.c includes this
+ *  file once for each value of SIM_VARIANT from 0 to SIM_VARIANTS-1,
+ *  and each inclusion defines SimulateVariant<n>(). The bits of
+ *  SIM_VARIANT say which run flags the variant was built for:
+ *
+ *      SIM_INTERACTIVE  1   prompt before every instruction
+ *      SIM_QUIET        2   print nothing per instruction
+ *      SIM_REGISTERS    4   print all registers, not just the changed one
+ *      SIM_MEMORY       8   print all nonzero memory, not just the changed word
+ *      SIM_HOOKS       16   feed the trace, timing, dataflow and event
+ *                           kernel tools
+ *
+ *  The flags are tested by the preprocessor, so a variant contains only
+ *  the code its combination needs and checks nothing per instruction.
+ *  mips.debugging is not used while simulating, so it isn't a flag here.
+ */
+
+#define SIM_INTERACTIVE ((SIM_VARIANT) & 1)
+#define SIM_QUIET ((SIM_VARIANT) & 2)
+#define SIM_REGISTERS ((SIM_VARIANT) & 4)
+#define SIM_MEMORY ((SIM_VARIANT) & 8)
+#define SIM_HOOKS ((SIM_VARIANT) & 16)
+
+static void SIM_NAME (SimulateVariant, SIM_VARIANT) () {
+#if SIM_INTERACTIVE
+    char s[40];  /* used for handling interactive input */
+#endif
+    unsigned int instr;
+    int changedReg=-1, changedMem=-1, val;
+#if SIM_HOOKS
+    int pc, addr;
+#endif
+    DecodedInstr d;
+
+    while (1) {
+#if SIM_INTERACTIVE
+        printf ("> ");
+        fgets (s,sizeof(s),stdin);
+        if (s[0] == 'q') {
+            return;
+        }
+#endif
+
+        /* Fetch instr at mips.pc, returning it in instr */
+        instr = Fetch (mips.pc);
+#if SIM_HOOKS
+        if (traceActive) {
+            TraceAccess (TRACE_IFETCH, mips.pc, 4);
+        }
+#endif
+
+#if !SIM_QUIET
+        printf ("Executing instruction at %8.8x: %8.8x\n", mips.pc, instr);
+#endif
+
+     /*
+	 * Decode instr, putting decoded instr in d
+	 * Note that we reuse the d struct for each instruction.
+	 */
+        DecodeCached (mips.pc, instr, &d, &rVals);
+
+#if !SIM_QUIET
+        /*Print decoded instruction*/
+        PrintInstruction(&d);
+#endif
+
+        /*
+	 * Perform computation needed to execute d, returning computed value
+	 * in val
+	 */
+        val = Execute(&d, &rVals);
+#if SIM_HOOKS
+        pc = mips.pc;
+        addr = val;
+#endif
+
+	UpdatePC(&d,val);
+
+        /*
+	 * Perform memory load or store. Place the
+	 * address of any updated memory in *changedMem,
+	 * otherwise put -1 in *changedMem.
+	 * Return any memory value that is read, otherwise return -1.
+         */
+        val = Mem(&d, val, &changedMem);
+
+        /*
+	 * Write back to register. If the instruction modified a register--
+	 * (including jal, which modifies $ra) --
+         * put the index of the modified register in *changedReg,
+         * otherwise put -1 in *changedReg.
+         */
+        RegWrite(&d, val, &changedReg);
+
+#if SIM_HOOKS
+        if (oooActive) {
+            OooInstruction (&d, pc, mips.pc, addr);
+        }
+        if (dataflowActive) {
+            DataflowInstruction (&d, pc, addr);
+        }
+        if (eventActive) {
+            EventInstruction (&d, pc, addr);
+        }
+#endif
+
+#if !SIM_QUIET
+        /*
+         *  Print relevant information about the state of the computer:
+         *  all the registers or just the one that changed, and all the
+         *  nonzero memory or just the memory location that changed.
+         */
+        printf ("New pc = %8.8x\n", mips.pc);
+#if SIM_REGISTERS
+        PrintRegisters ();
+#else
+        if (changedReg == -1) {
+            printf ("No register was updated.\n");
+        } else {
+            printf ("Updated r%2.2d to %8.8x\n",
+            changedReg, mips.registers[changedReg]);
+        }
+#endif
+#if SIM_MEMORY
+        PrintMemory ();
+#else
+        if (changedMem == -1) {
+            printf ("No memory location was updated.\n");
+        } else {
+            printf ("Updated memory at address %8.8x to %8.8x\n",
+            changedMem, Fetch (changedMem));
+        }
+#endif
+#endif
+    }
+}
+
+#undef SIM_INTERACTIVE
+#undef SIM_QUIET
+#undef SIM_REGISTERS
+#undef SIM_MEMORY
+#undef SIM_HOOKS
+#undef SIM_VARIANT
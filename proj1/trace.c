@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+/* Nonzero while a trace file is open; tested by Simulate() and Mem() */
+int traceActive = 0;
+
+static FILE* traceFile;
+static TraceFormat traceFormat;
+static char traceBuffer[TRACE_BUFFER_SIZE];
+static int traceLength;
+
+static void TraceFlush () {
+    if (traceLength > 0) {
+        fwrite (traceBuffer, 1, traceLength, traceFile);
+        traceLength = 0;
+    }
+}
+
+/*
+ *  Open the trace file and write the header for the binary format.
+ *  The file is flushed and closed automatically when the simulator
+ *  exits, since a program normally ends by exiting from Decode().
+ *  Returns 0 on success, -1 if the file can't be opened.
+ */
+int TraceOpen (const char* filename, TraceFormat format) {
+    unsigned int version = TRACE_VERSION;
+
+    traceFile = fopen (filename, format == TRACE_BINARY ? "wb" : "w");
+    if (traceFile == NULL) {
+        return -1;
+    }
+    traceFormat = format;
+    traceLength = 0;
+
+    if (format == TRACE_BINARY) {
+        memcpy (traceBuffer, TRACE_MAGIC, 4);
+        traceBuffer[4] = version & 0xff;
+        traceBuffer[5] = (version>>8) & 0xff;
+        traceBuffer[6] = (version>>16) & 0xff;
+        traceBuffer[7] = (version>>24) & 0xff;
+        traceLength = 8;
+    }
+
+    traceActive = 1;
+    atexit (TraceClose);
+    return 0;
+}
+
+/*
+ *  Append one access to the trace. Records are accumulated in
+ *  traceBuffer and only reach the file in TRACE_BUFFER_SIZE chunks.
+ */
+void TraceAccess (TraceType type, int addr, int size) {
+    unsigned int a = addr;
+    char* rec;
+
+    if (traceLength > TRACE_BUFFER_SIZE - 32) {
+        TraceFlush ();
+    }
+    rec = traceBuffer + traceLength;
+
+    if (traceFormat == TRACE_BINARY) {
+        rec[0] = type;
+        rec[1] = size;
+        rec[2] = 0;
+        rec[3] = 0;
+        rec[4] = a & 0xff;
+        rec[5] = (a>>8) & 0xff;
+        rec[6] = (a>>16) & 0xff;
+        rec[7] = (a>>24) & 0xff;
+        traceLength += TRACE_RECORD_SIZE;
+    } else {
+        traceLength += sprintf (rec, "%d %x\n", type, a);
+    }
+}
+
+void TraceClose () {
+    if (!traceActive) {
+        return;
+    }
+    TraceFlush ();
+    fclose (traceFile);
+    traceActive = 0;
+}
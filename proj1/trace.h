@@ -0,0 +1,33 @@
+
+/*
+ *  Memory address trace export. Every instruction fetch and every lw/sw
+ *  data access seen by Simulate() can be written to a trace file, either
+ *  in a compact binary format or as Dinero "din" text, so one simulation
+ *  run can drive any number of offline cache studies.
+ *
+ *  Binary format: an 8-byte header ("MTRC" followed by a little-endian
+ *  version word), then one 8-byte record per access:
+ *      byte 0    access type (TraceType below)
+ *      byte 1    access size in bytes
+ *      bytes 2-3 reserved, zero
+ *      bytes 4-7 address, little-endian
+ *
+ *  Din format: one "<label> <hex address>" line per access, with the
+ *  standard labels 0 = data read, 1 = data write, 2 = instruction fetch.
+ */
+
+#define TRACE_MAGIC "MTRC"
+#define TRACE_VERSION 1
+#define TRACE_RECORD_SIZE 8
+#define TRACE_BUFFER_SIZE (1<<20)	/* bytes buffered before each write */
+
+typedef enum { TRACE_BINARY=0, TRACE_DIN } TraceFormat;
+
+/* Values match the din labels so they can be written out directly */
+typedef enum { TRACE_READ=0, TRACE_WRITE=1, TRACE_IFETCH=2 } TraceType;
+
+extern int traceActive;
+
+int TraceOpen (const char* filename, TraceFormat format);
+void TraceAccess (TraceType type, int addr, int size);
+void TraceClose ();
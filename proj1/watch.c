@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "computer.h"
+#include "watch.h"
+#undef mips			/* gcc already has a def for mips */
+
+extern Computer mips;
+
+/* Set by the fault handler until WatchRearm() runs */
+volatile int watchPending = 0;
+
+static int watchAddr[WATCH_MAX];
+static char watchHalt[WATCH_MAX];
+static int watchCount;
+
+/* Per guest word: WATCHED, with HALTS too if a watchpoint on it halts */
+#define WATCHED 1
+#define HALTS 2
+static char watched[MAXNUMINSTRS+MAXNUMDATA];
+static long pageSize;
+
+/* What the last fault hit; written only by the handler */
+static volatile long faultPage;
+static volatile int faultWord = -1;
+static volatile int faultOld;
+
+/*
+ *  Watch the word at guest address addr. With halt set, the simulation
+ *  stops at the first change to it; otherwise each change is reported
+ *  and the run goes on. Returns 0 on success, -1 if the address is
+ *  unaligned, outside memory, or too many are watched.
+ */
+int WatchAdd (int addr, int halt) {
+    if ((addr & 3) != 0 || addr < 0x00400000
+        || addr >= 0x00400000 + 4*(MAXNUMINSTRS+MAXNUMDATA)
+        || watchCount == WATCH_MAX) {
+        return -1;
+    }
+    watchHalt[watchCount] = halt;
+    watchAddr[watchCount++] = addr;
+    return 0;
+}
+
+static void Protect (long page, int prot) {
+    mprotect ((char*) mips.memory + page, pageSize, prot);
+}
+
+static void WatchFault (int sig, siginfo_t* info, void* context) {
+    char* base = (char*) mips.memory;
+    char* fault = info->si_addr;
+    long offset;
+
+    if (fault < base || fault >= base + 4*(MAXNUMINSTRS+MAXNUMDATA)) {
+        /* Not a watched page, so a real crash: let it happen */
+        signal (SIGSEGV, SIG_DFL);
+        return;
+    }
+    offset = fault - base;
+    faultPage = offset - offset % pageSize;
+    Protect (faultPage, PROT_READ|PROT_WRITE);
+    if (watched[offset/4]) {
+        faultWord = offset/4;
+        faultOld = mips.memory[offset/4];
+    }
+    watchPending = 1;
+}
+
+/*
+ *  Protect the pages of every watched word and install the fault
+ *  handler. Call after InitComputer(). Returns 0 on success, -1 if
+ *  guest memory can't be protected.
+ */
+int WatchStart () {
+    struct sigaction action;
+    int k, word;
+
+    pageSize = sysconf (_SC_PAGESIZE);
+    memset (&action, 0, sizeof (action));
+    action.sa_sigaction = WatchFault;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset (&action.sa_mask);
+    if (sigaction (SIGSEGV, &action, NULL) != 0) {
+        return -1;
+    }
+
+    for (k=0; k<watchCount; k++) {
+        word = (watchAddr[k] - 0x00400000)/4;
+        watched[word] |= watchHalt[k] ? WATCHED|HALTS : WATCHED;
+        if (mprotect ((char*) mips.memory + (4L*word - 4L*word % pageSize),
+                      pageSize, PROT_READ) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ *  Called after a store that faulted: report the change if the store
+ *  hit a watched word, then protect the page again.
+ */
+void WatchRearm () {
+    int word = faultWord;
+
+    watchPending = 0;
+    faultWord = -1;
+    if (word >= 0 && mips.memory[word] != faultOld) {
+        printf ("Watchpoint: pc %8.8x changed memory at %8.8x from %8.8x to %8.8x\n",
+            mips.pc - 4, 0x00400000 + 4*word, faultOld, mips.memory[word]);
+        if (watched[word] & HALTS) {
+            exit (0);
+        }
+    }
+    Protect (faultPage, PROT_READ);
+}
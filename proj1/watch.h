@@ -0,0 +1,17 @@
+
+/*
+ *  Memory watchpoints backed by host page protection. The host pages
+ *  holding watched guest words are made read-only, so only a store to
+ *  one of those pages traps into the SIGSEGV handler; every other store
+ *  runs at full speed. The handler lets the store through and Mem()
+ *  calls WatchRearm() afterwards, which reports a change to a watched
+ *  word and protects the page again.
+ */
+
+#define WATCH_MAX 64		/* watched words */
+
+extern volatile int watchPending;
+
+int WatchAdd (int addr, int halt);
+int WatchStart ();
+void WatchRearm ();
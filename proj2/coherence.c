@@ -0,0 +1,393 @@
+#include "tips.h"
+#include "util.h"
+
+/*
+  Multiple cores. Each core runs the loaded program with its own
+  registers, starting with its number in $a0 and its own CORE_STACK_SIZE
+  bytes of stack, and the cores take turns an instruction at a time.
+  Every core fetches and accesses data through a private write-back
+  cache shaped like the hierarchy's L1 data cache, and the private
+  caches share DRAM over a snooping bus that keeps them coherent.
+
+  A block's state comes from its valid and dirty bits and whether other
+  cores may hold it too:
+
+    M  Modified   valid, dirty, not shared
+    O  Owned      valid, dirty, shared (MOESI only)
+    E  Exclusive  valid, clean, not shared
+    S  Shared     valid, clean, shared
+    I  Invalid
+
+  A read miss puts BusRd on the bus. A core holding the block M or O
+  supplies it; under MESI it also writes it to DRAM and keeps an S copy,
+  under MOESI it keeps it O and DRAM stays stale. Every other copy becomes
+  S, and the reader gets S if there were any, else E from DRAM. A write
+  miss puts BusRdX on the bus and a write to an S or O block BusUpgr;
+  every other copy is invalidated and the writer's becomes M. A write to
+  an E block becomes M without the bus. M and O blocks are written back
+  when they are evicted.
+
+  The bus carries one transaction at a time, so every access completes
+  before the next starts. A miss to a block that was last lost here to
+  another core's write is a coherence miss.
+
+  Timing follows timing.c. A transaction takes BUS_CYCLES to win the bus
+  and broadcast, then a fill from DRAM takes DRAM's time and one from
+  another core that core's hit latency plus the transfer at DRAM
+  bandwidth.
+*/
+
+#define CHUNK_BITS 16                    /* blocks per bitmap chunk, as a power of two */
+#define BUS_CYCLES 1
+
+snoopingBus bus;
+
+static char* protocol_keys[] = { "mesi", "moesi" };
+static char* protocol_names[] = { "MESI", "MOESI" };
+
+/* The protocol called key, or -1 */
+int parse_protocol(const char* key)
+{
+  int i;
+
+  for(i = 0; i <= MOESI; i++)
+    if(strcmp(key, protocol_keys[i]) == 0)
+      return i;
+  return -1;
+}
+
+static cacheLevel* private_cache(int id)
+{
+  return &bus.core[id].cache.level[L1D];
+}
+
+static unsigned int chunk_count(int id)
+{
+  return 1u << (32 - private_cache(id)->offset_bits - CHUNK_BITS);
+}
+
+/* Forget the blocks core id lost to invalidations */
+static void forget_lost(int id)
+{
+  processorCore* c = &bus.core[id];
+  unsigned int i;
+
+  for(i = 0; i < chunk_count(id); i++)
+  {
+    free(c->lost[i]);
+    c->lost[i] = NULL;
+  }
+}
+
+/* Remember that core id lost block to another core's write */
+static void mark_lost(int id, unsigned int block)
+{
+  unsigned int** chunk = &bus.core[id].lost[block >> CHUNK_BITS];
+  unsigned int bit = block & ((1u << CHUNK_BITS) - 1);
+
+  if(*chunk == NULL && (*chunk = calloc(1, sizeof(unsigned int) << (CHUNK_BITS - 5))) == NULL)
+  {
+    fprintf(stderr, "Unable to allocate memory for coherence statistics\n");
+    exit(1);
+  }
+  (*chunk)[bit >> 5] |= 1u << (bit & 31);
+}
+
+/* Nonzero if core id lost block to another core's write since it last held it */
+static int take_lost(int id, unsigned int block)
+{
+  unsigned int* chunk = bus.core[id].lost[block >> CHUNK_BITS];
+  unsigned int bit = block & ((1u << CHUNK_BITS) - 1);
+
+  if(chunk == NULL || !(chunk[bit >> 5] & 1u << (bit & 31)))
+    return 0;
+  chunk[bit >> 5] &= ~(1u << (bit & 31));
+  return 1;
+}
+
+/*
+  Give each of bus.count cores a private cache shaped like the
+  hierarchy's L1 data cache, freeing the old ones, and flush them. There
+  are no cores without an L1 data cache to copy.
+*/
+void allocate_cores(void)
+{
+  cacheLevel* l1d = &hierarchy.level[L1D];
+  processorCore* c;
+  cacheLevel* level;
+  int i;
+
+  free_cores();
+  if(l1d->set_count == 0 || l1d->assoc == 0 || l1d->block_size == 0)
+    bus.count = 0;
+
+  for(i = 0; i < bus.count; i++)
+  {
+    c = &bus.core[i];
+    init_hierarchy(&c->cache);
+    level = &c->cache.level[L1D];
+    level->set_count = l1d->set_count;
+    level->assoc = l1d->assoc;
+    level->block_size = l1d->block_size;
+    level->policy = l1d->policy;
+    level->hit_latency = l1d->hit_latency;
+    c->cache.dram_latency = hierarchy.dram_latency;
+    c->cache.dram_bandwidth = hierarchy.dram_bandwidth;
+    allocate_hierarchy(&c->cache);
+
+    c->lost = calloc(chunk_count(i), sizeof(unsigned int*));
+    if(c->lost == NULL)
+    {
+      fprintf(stderr, "Unable to allocate memory for coherence statistics\n");
+      exit(1);
+    }
+  }
+  flush_cores();
+}
+
+void free_cores(void)
+{
+  int i;
+
+  for(i = 0; i < MAX_CORES; i++)
+  {
+    if(bus.core[i].lost == NULL)
+      continue;
+    forget_lost(i);
+    free(bus.core[i].lost);
+    bus.core[i].lost = NULL;
+    free_hierarchy(&bus.core[i].cache);
+  }
+}
+
+/* Invalidate every block of every core and clear the statistics */
+void flush_cores(void)
+{
+  int i;
+
+  for(i = 0; i < bus.count; i++)
+  {
+    flush_hierarchy(&bus.core[i].cache);
+    forget_lost(i);
+    memset(&bus.core[i].stats, 0, sizeof(coherenceStats));
+  }
+  memset(bus.transactions, 0, sizeof(bus.transactions));
+  bus.cache_transfers = 0;
+}
+
+/* Start every core at the beginning of the program, from the state reinit_processor() just set */
+void reset_cores(void)
+{
+  cpuState* s;
+  int i;
+
+  for(i = 0; i < bus.count; i++)
+  {
+    s = &bus.core[i].cpu;
+    save_processor(s);
+    s->registers[4] = i;                               /* $a0 */
+    s->registers[29] = STACK_START - i * CORE_STACK_SIZE; /* $sp */
+  }
+  bus.current = 0;
+  if(bus.count != 0)
+    load_processor(&bus.core[0].cpu);
+}
+
+/* Run an instruction on every core in turn */
+void step_cores(void)
+{
+  int i;
+
+  for(i = 0; i < bus.count; i++)
+  {
+    bus.current = i;
+    load_processor(&bus.core[i].cpu);
+    step_processor();
+    save_processor(&bus.core[i].cpu);
+  }
+}
+
+/*
+  Put transaction t of core id for the block at addr on the bus, for
+  every other core to snoop. A core holding the block dirty copies it
+  into data for a BusRd or BusRdX, and *supplied is set. Returns the
+  number of other cores that held the block.
+*/
+static int snoop(int id, BusTransaction t, address addr, byte* data, int* supplied)
+{
+  processorCore* c;
+  cacheLevel* level;
+  cacheBlock* block;
+  int copies = 0;
+  int i;
+
+  bus.transactions[t]++;
+  *supplied = 0;
+  for(i = 0; i < bus.count; i++)
+  {
+    level = private_cache(i);
+    if(i == id || (block = find_block(level, addr)) == NULL)
+      continue;
+    c = &bus.core[i];
+    copies++;
+
+    /* An upgrading writer already has the data; any dirty copy matches it */
+    if(block->dirty == DIRTY && t != BUS_UPGRADE)
+    {
+      memcpy(data, block->data, level->block_size);
+      c->stats.supplied++;
+      *supplied = 1;
+      if(t == BUS_READ && bus.protocol == MESI)
+      {
+        /* M becomes S, and S copies must match DRAM */
+        accessDRAM(addr & ~(level->block_size - 1), block->data, (TransferUnit)uint_log2(level->block_size), WRITE);
+        c->cache.dram_writes += level->block_size;
+        block->dirty = VIRGIN;
+      }
+    }
+
+    if(t == BUS_READ)
+      block->shared = 1;
+    else
+    {
+      block->valid = INVALID;
+      block->dirty = VIRGIN;
+      c->stats.invalidations++;
+      mark_lost(i, addr >> level->offset_bits);
+    }
+  }
+  return copies;
+}
+
+/* Make room in block of core id, writing it back if it is M or O. Returns the cycles that takes */
+static unsigned int evict_block(int id, unsigned int index, cacheBlock* block)
+{
+  cacheHierarchy* h = &bus.core[id].cache;
+  cacheLevel* level = &h->level[L1D];
+
+  if(block->valid != VALID)
+    return 0;
+  level->stats.evictions++;
+  block->valid = INVALID;
+  if(block->dirty != DIRTY)
+    return 0;
+
+  level->stats.writebacks++;
+  bus.transactions[BUS_WRITEBACK]++;
+  accessDRAM(block_address(level, index, block), block->data, (TransferUnit)uint_log2(level->block_size), WRITE);
+  h->dram_writes += level->block_size;
+  block->dirty = VIRGIN;
+  return BUS_CYCLES + dram_cycles(h, level->block_size);
+}
+
+/* Read or write a word of data for core id through its private cache */
+void coherent_access(int id, AccessKind kind, address addr, word* data, WriteEnable we)
+{
+  cacheHierarchy* h = &bus.core[id].cache;
+  cacheLevel* level = &h->level[L1D];
+  unsigned int index = set_index(level, addr);
+  unsigned int size = level->block_size;
+  cacheBlock* block = find_block(level, addr);
+  unsigned long long cycles = level->hit_latency;
+  byte fill[MAX_BLOCK_SIZE];
+  int copies;
+  int supplied;
+
+  if(we == READ)
+    level->stats.reads++;
+  else
+    level->stats.writes++;
+
+  if(block == NULL)
+  {
+    if(we == READ)
+      level->stats.read_misses++;
+    else
+      level->stats.write_misses++;
+    if(take_lost(id, addr >> level->offset_bits))
+      bus.core[id].stats.coherence_misses++;
+
+    copies = snoop(id, we == READ ? BUS_READ : BUS_READ_EXCLUSIVE, addr, fill, &supplied);
+    cycles += BUS_CYCLES;
+    if(supplied)
+    {
+      /* The supplier looks the block up, then sends it at DRAM's bandwidth */
+      bus.cache_transfers++;
+      cycles += level->hit_latency + dram_cycles(h, size) - h->dram_latency;
+    }
+    else
+    {
+      accessDRAM(addr & ~(size - 1), fill, (TransferUnit)uint_log2(size), READ);
+      h->dram_reads += size;
+      cycles += dram_cycles(h, size);
+    }
+
+    block = choose_victim(level, &level->sets[index]);
+    cycles += evict_block(id, index, block);
+    memcpy(block->data, fill, size);
+    block->tag = tag_of(level, addr);
+    block->valid = VALID;
+    block->dirty = VIRGIN;
+    block->shared = copies != 0;
+    filled(level, index, block);
+  }
+  else
+  {
+    touch(level, index, block);
+    if(we == WRITE && block->shared)
+    {
+      snoop(id, BUS_UPGRADE, addr, NULL, &supplied);
+      cycles += BUS_CYCLES;
+    }
+  }
+
+  if(we == READ)
+    memcpy(data, block->data + (addr & (size - 1)), sizeof(word));
+  else
+  {
+    memcpy(block->data + (addr & (size - 1)), data, sizeof(word));
+    block->dirty = DIRTY;
+    block->shared = 0;
+  }
+  record_access(h, kind, cycles);
+}
+
+static double ratio(unsigned long long part, unsigned long long whole)
+{
+  return whole ? (double)part / whole : 0.0;
+}
+
+/* Write each core's accesses, misses and coherence counts, then the bus's */
+void print_coherence_stats(FILE* out)
+{
+  processorCore* c;
+  cacheLevel* level;
+  cacheStats* s;
+  timingStats* t;
+  unsigned long long dram_reads = 0;
+  unsigned long long dram_writes = 0;
+  int i;
+
+  if(bus.count == 0)
+    return;
+  level = private_cache(0);
+  fprintf(out, "%d cores kept coherent by %s, each with a %u set, %u-way cache of %u byte blocks\n",
+          bus.count, protocol_names[bus.protocol], level->set_count, level->assoc, level->block_size);
+  fprintf(out, "Core      Reads   R-Miss     Writes   W-Miss  Coherence  Invalidated  Supplied     CPI\n");
+  for(i = 0; i < bus.count; i++)
+  {
+    c = &bus.core[i];
+    s = &c->cache.level[L1D].stats;
+    t = &c->cache.timing;
+    fprintf(out, "%4d %10llu  %6.2f%% %10llu  %6.2f%% %10llu  %11llu  %8llu  %6.3f\n", i,
+            s->reads, 100 * ratio(s->read_misses, s->reads), s->writes, 100 * ratio(s->write_misses, s->writes),
+            c->stats.coherence_misses, c->stats.invalidations, c->stats.supplied,
+            ratio(t->cycles, t->accesses[INSTRUCTION_FETCH]));
+    dram_reads += c->cache.dram_reads;
+    dram_writes += c->cache.dram_writes;
+  }
+  fprintf(out, "Bus   %llu BusRd, %llu BusRdX, %llu BusUpgr, %llu write backs; %llu fills from other cores\n",
+          bus.transactions[BUS_READ], bus.transactions[BUS_READ_EXCLUSIVE], bus.transactions[BUS_UPGRADE],
+          bus.transactions[BUS_WRITEBACK], bus.cache_transfers);
+  fprintf(out, "DRAM  %llu bytes read, %llu bytes written\n", dram_reads, dram_writes);
+}
@@ -53,9 +53,9 @@ unsigned int getTarget(const word instr){
   return instr & 0x03ffffff;
 }
 
-void disassemble_inst(word inst)
+/* Write the assembly for inst, at address pc, into buffer */
+void disassemble_inst(word inst, address pc, char* buffer)
 {
-  char buffer[200];
   switch(getOpcode(inst))
   {
   case 0: /* R-type */
@@ -142,16 +142,16 @@ void disassemble_inst(word inst)
     }
     break;
   case 2: /* j     */
-    sprintf(buffer, "j\t\t0x%.8X\n", (unsigned int)((PC & 0xf0000000) | getTarget(inst) << 2));
+    sprintf(buffer, "j\t\t0x%.8X\n", (unsigned int)(((pc + 4) & 0xf0000000) | getTarget(inst) << 2));
     break;
   case 3: /* jal   */
-    sprintf(buffer, "jal\t0x%.8X\n", (unsigned int)((PC & 0xf0000000) | getTarget(inst) << 2));
+    sprintf(buffer, "jal\t0x%.8X\n", (unsigned int)(((pc + 4) & 0xf0000000) | getTarget(inst) << 2));
     break;
   case 4: /* beq   */
-    sprintf(buffer, "beq\t$%u, $%u, 0x%.8X\n", getRs(inst), getRt(inst), (unsigned int)((getSImmed(inst) << 2) + PC));
+    sprintf(buffer, "beq\t$%u, $%u, 0x%.8X\n", getRs(inst), getRt(inst), (unsigned int)((getSImmed(inst) << 2) + pc + 4));
     break;
   case 5: /* bne   */
-    sprintf(buffer, "bne\t$%u, $%u, 0x%.8X\n", getRs(inst), getRt(inst), (unsigned int)((getSImmed(inst) << 2) + PC));
+    sprintf(buffer, "bne\t$%u, $%u, 0x%.8X\n", getRs(inst), getRt(inst), (unsigned int)((getSImmed(inst) << 2) + pc + 4));
     break;
   case 8: /* addi  */
     sprintf(buffer, "addi\t$%u, $%u, %d\n", getRt(inst), getRs(inst), getSImmed(inst));
@@ -195,8 +195,6 @@ void disassemble_inst(word inst)
   default:
     sprintf(buffer, "Unsupported instruction\n");
   }
-
-  append_log(buffer);
 }
 
 void execute_inst(word inst)
@@ -343,31 +341,43 @@ void reinit_processor()
   PC = PROGRAM_START;
   registers[29] = STACK_START;
   registers[31] = PROGRAM_START;
+  reset_cores();
   refresh_register_display();
 }
 
+/* Copy the processor's state into s, so another core can run */
+void save_processor(cpuState* s)
+{
+  memcpy(s->registers, registers, sizeof(registers));
+  memcpy(s->hilo, hilo, sizeof(hilo));
+  s->PC = PC;
+}
+
+/* Make s the processor's state */
+void load_processor(const cpuState* s)
+{
+  memcpy(registers, s->registers, sizeof(registers));
+  memcpy(hilo, s->hilo, sizeof(hilo));
+  PC = s->PC;
+}
+
 void step_processor()
 {
-  char buffer[200];
   word inst;
 
   /* Flush previously drawn items */
   flush_drawlist();
 
   /* Fetch Instruction */
-  accessMemory(PC, &inst, READ);
+  fetch_instruction(PC, &inst);
   inst = ntohl(inst);
 
-  /* Print PC */
-  sprintf(buffer, "[0x%08X]: 0x%08X\t", PC, inst);
-  append_log(buffer);
+  /* Log the instruction */
+  log_instruction(PC, inst);
 
   /* Increment PC */
   PC += sizeof(instruction); 
 
-  /* Disassemble Instruction */
-  disassemble_inst(inst);
-
   /* Execute Instruction */
   execute_inst(inst);
   
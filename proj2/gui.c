@@ -1180,17 +1180,17 @@ gboolean configure_button_listener(GtkWidget *widget, GdkEventExpose *event, gpo
   switch(result)
   {
   case GTK_RESPONSE_ACCEPT:
-    validate_cache_parameters(atoi(gtk_entry_get_text(GTK_ENTRY(index_entry))),
-			      atoi(gtk_entry_get_text(GTK_ENTRY(assoc_entry))),
-			      atoi(gtk_entry_get_text(GTK_ENTRY(block_entry))));
     assert(panel_replacement_policy == RANDOM || panel_replacement_policy == LRU || panel_replacement_policy == LFU);
     policy = panel_replacement_policy;
     assert(panel_memory_sync_policy == WRITE_BACK || panel_memory_sync_policy == WRITE_THROUGH);
     memory_sync_policy = panel_memory_sync_policy;
+    validate_cache_parameters(atoi(gtk_entry_get_text(GTK_ENTRY(index_entry))),
+			      atoi(gtk_entry_get_text(GTK_ENTRY(assoc_entry))),
+			      atoi(gtk_entry_get_text(GTK_ENTRY(block_entry))));
     assert(panel_cache_view == INDEX || panel_cache_view == ASSOC);
     view = panel_cache_view;
 
-    sprintf(buffer, "Cache parameters changed:\n + set count = %d\n + associativity = %d\n + block size = %d\n + replacement policy = %s\n + memory sync policy = %s\n", set_count, assoc, block_size, (policy == RANDOM ? "Random" : (policy == LRU ? "LRU" : "LFU")), (memory_sync_policy == WRITE_BACK ? "Write Back" : "Write Through"));
+    sprintf(buffer, "Cache parameters changed:\n + set count = %d\n + associativity = %d\n + block size = %d\n + replacement policy = %s\n + memory sync policy = %s\n", set_count, assoc, block_size, policy_name(policy), (memory_sync_policy == WRITE_BACK ? "Write Back" : "Write Through"));
     append_log(buffer);
     configure_cache_drawing_parameters(cache_canvas);
     flush_cache();
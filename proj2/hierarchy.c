@@ -0,0 +1,794 @@
+#include "tips.h"
+#include "util.h"
+
+/*
+  The cache hierarchy: split L1 instruction and data caches in front of
+  unified L2 and L3 caches and DRAM. Any level may be left out, in which
+  case the levels above it fill straight from the next one present.
+  Without an L1 instruction cache, instructions are fetched through the
+  L1 data cache. The L1 instruction cache is not kept coherent with
+  stores, so code that writes instructions must flush the cache.
+
+  Block sizes never shrink going down, so a block of an upper level
+  always lies inside a single block of any level below it. Every level
+  allocates on write.
+*/
+
+static char* level_names[LEVEL_COUNT] = { "L1I", "L1D", "L2", "L3" };
+static unsigned int hit_latencies[LEVEL_COUNT] = { 1, 1, 10, 30 };
+
+static void evict(cacheLevel* level, unsigned int index, cacheBlock* block);
+
+void init_hierarchy(cacheHierarchy* h)
+{
+  int i;
+
+  memset(h, 0, sizeof(cacheHierarchy));
+  for(i = 0; i < LEVEL_COUNT; i++)
+  {
+    h->level[i].name = level_names[i];
+    h->level[i].policy = LRU;
+    h->level[i].memory_sync_policy = WRITE_BACK;
+    h->level[i].hierarchy = h;
+    h->level[i].seed = i + 1;
+    h->level[i].hit_latency = hit_latencies[i];
+  }
+  h->dram_latency = 100;
+  h->dram_bandwidth = 8;
+}
+
+static int level_present(cacheLevel* level)
+{
+  return level->set_count != 0 && level->assoc != 0 && level->block_size != 0;
+}
+
+/*
+  Allocate a level's blocks, freeing the old ones. There is always at
+  least one set of one block so the L1 data cache can be drawn while one
+  of its parameters is 0. In a tags-only hierarchy all the blocks share
+  one block of scratch data.
+*/
+static void allocate_level(cacheLevel* level)
+{
+  unsigned int sets = level->set_count ? level->set_count : 1;
+  unsigned int ways = level->assoc ? level->assoc : 1;
+  unsigned int stride = level->hierarchy->tags_only ? 0 : level->block_size;
+  unsigned int i;
+
+  if(level->sets != NULL)
+    free(level->sets[0].block);
+  free(level->sets);
+  free(level->storage);
+
+  level->sets = calloc(sets, sizeof(cacheSet));
+  level->storage = stride ? calloc((size_t)sets * ways, stride) : calloc(1, MAX_BLOCK_SIZE);
+  if(level->sets != NULL)
+    level->sets[0].block = calloc((size_t)sets * ways, sizeof(cacheBlock));
+  if(level->sets == NULL || level->storage == NULL || level->sets[0].block == NULL)
+  {
+    fprintf(stderr, "Unable to allocate a %u x %u x %u byte %s cache\n", sets, ways, level->block_size, level->name);
+    exit(1);
+  }
+
+  for(i = 0; i < sets * ways; i++)
+    level->sets[0].block[i].data = level->storage + (size_t)i * stride;
+  for(i = 1; i < sets; i++)
+    level->sets[i].block = level->sets[0].block + (size_t)i * ways;
+
+  level->replacement = &replacement_policies[level->policy];
+  allocate_prefetcher(level);
+  level->offset_bits = level->block_size ? uint_log2(level->block_size) : 0;
+  level->index_bits = level->set_count ? uint_log2(level->set_count) : 0;
+  allocate_victim_cache(level);
+  allocate_detail(level);
+}
+
+/*
+  Link the levels that are present, raise any block size smaller than
+  one above it, and allocate every level. The contents are flushed.
+*/
+void allocate_hierarchy(cacheHierarchy* h)
+{
+  cacheLevel* below = NULL;
+  cacheLevel* level;
+  int i;
+
+  for(i = LEVEL_COUNT - 1; i >= 0; i--)
+  {
+    level = &h->level[i];
+    level->next = below;
+    level->above[0] = level->above[1] = NULL;
+    if(i >= L2 && level_present(level))
+      below = level;
+  }
+
+  h->first[DATA_ACCESS] = level_present(&h->level[L1D]) ? &h->level[L1D] : below;
+  h->first[INSTRUCTION_FETCH] = level_present(&h->level[L1I]) ? &h->level[L1I] : h->first[DATA_ACCESS];
+  for(i = 0; i < 2; i++)
+  {
+    level = h->first[i];
+    if(level != NULL && level->next != NULL && level->next->above[0] != level)
+      level->next->above[level->next->above[0] != NULL] = level;
+  }
+  if(level_present(&h->level[L2]) && h->level[L2].next != NULL)
+    h->level[L2].next->above[0] = &h->level[L2];
+
+  for(i = 0; i < LEVEL_COUNT; i++)
+  {
+    level = &h->level[i];
+    if(level_present(level) && level->next != NULL && level->next->block_size < level->block_size)
+      level->next->block_size = level->block_size;
+  }
+
+  for(i = 0; i < LEVEL_COUNT; i++)
+    allocate_level(&h->level[i]);
+  allocate_write_buffer(h);
+  flush_hierarchy(h);
+}
+
+void free_hierarchy(cacheHierarchy* h)
+{
+  int i;
+
+  for(i = 0; i < LEVEL_COUNT; i++)
+  {
+    if(h->level[i].sets != NULL)
+      free(h->level[i].sets[0].block);
+    free(h->level[i].sets);
+    free(h->level[i].storage);
+    free_prefetcher(&h->level[i]);
+    free_victim_cache(&h->level[i]);
+    free_detail(&h->level[i]);
+    h->level[i].sets = NULL;
+    h->level[i].storage = NULL;
+  }
+  free_write_buffer(h);
+}
+
+/* Invalidate every block without writing anything back */
+void flush_hierarchy_blocks(cacheHierarchy* h)
+{
+  cacheLevel* level;
+  cacheBlock* block;
+  unsigned int i;
+  int l;
+
+  for(l = 0; l < LEVEL_COUNT; l++)
+  {
+    level = &h->level[l];
+    for(i = 0; i < (level->set_count ? level->set_count : 1) * (level->assoc ? level->assoc : 1); i++)
+    {
+      block = &level->sets[0].block[i];
+      block->valid = INVALID;
+      block->dirty = VIRGIN;
+      block->lru.value = 0;
+      block->accessCount = 0;
+      block->prefetched = 0;
+      block->shared = 0;
+    }
+    flush_prefetcher(level);
+    flush_victim_cache(level);
+    clear_classifier(level);
+    for(i = 0; i < (level->set_count ? level->set_count : 1); i++)
+      level->sets[i].state = 0;
+    level->clock = 0;
+  }
+  flush_write_buffer(h);
+}
+
+/* Invalidate every block and clear the statistics and profile */
+void flush_hierarchy(cacheHierarchy* h)
+{
+  int l;
+
+  flush_hierarchy_blocks(h);
+  restart_profile(h);
+  for(l = 0; l < LEVEL_COUNT; l++)
+  {
+    memset(&h->level[l].stats, 0, sizeof(cacheStats));
+    memset(h->level[l].type_stats, 0, sizeof(h->level[l].type_stats));
+    if(h->level[l].set_stats != NULL)
+      memset(h->level[l].set_stats, 0, sizeof(detailStats) * h->level[l].set_count);
+  }
+  h->dram_reads = 0;
+  h->dram_writes = 0;
+  memset(h->dram_bytes, 0, sizeof(h->dram_bytes));
+  memset(&h->timing, 0, sizeof(timingStats));
+  memset(&h->write_buffer.stats, 0, sizeof(writeBufferStats));
+}
+
+static void access_dram(cacheHierarchy* h, address addr, byte* data, unsigned int size, WriteEnable we)
+{
+  writeBuffer* wb = &h->write_buffer;
+
+  if(we == WRITE && wb->entries != 0)
+  {
+    buffer_write(h, addr, data, size);
+    return;
+  }
+  /* A read the write buffer holds entirely never reaches DRAM */
+  if(we == READ && wb->count != 0 && buffer_holds(h, addr, size))
+  {
+    forward_buffered(h, addr, data, size);
+    return;
+  }
+
+  if(!h->tags_only)
+    accessDRAM(addr, data, (TransferUnit)uint_log2(size), we);
+  h->latency += dram_cycles(h, size);
+  if(we == READ)
+    h->dram_reads += size;
+  else
+    h->dram_writes += size;
+  h->dram_bytes[h->type][we] += size;
+  if(we == READ && wb->count != 0)
+    forward_buffered(h, addr, data, size);
+}
+
+unsigned int set_index(cacheLevel* level, address addr)
+{
+  return (addr >> level->offset_bits) & (level->set_count - 1);
+}
+
+unsigned int tag_of(cacheLevel* level, address addr)
+{
+  return addr >> (level->offset_bits + level->index_bits);
+}
+
+address block_address(cacheLevel* level, unsigned int index, cacheBlock* block)
+{
+  return (block->tag << (level->offset_bits + level->index_bits)) | (index << level->offset_bits);
+}
+
+cacheBlock* find_block(cacheLevel* level, address addr)
+{
+  cacheSet* set = &level->sets[set_index(level, addr)];
+  unsigned int tag = tag_of(level, addr);
+  unsigned int i;
+
+  for(i = 0; i < level->assoc; i++)
+    if(set->block[i].valid == VALID && set->block[i].tag == tag)
+      return &set->block[i];
+  return NULL;
+}
+
+/* Tell the replacement policy a valid block was used again */
+void touch(cacheLevel* level, unsigned int index, cacheBlock* block)
+{
+  cacheSet* set = &level->sets[index];
+
+  level->replacement->on_hit(level, set, block - set->block);
+}
+
+/* Tell the replacement policy a block was just placed */
+void filled(cacheLevel* level, unsigned int index, cacheBlock* block)
+{
+  cacheSet* set = &level->sets[index];
+
+  level->replacement->on_fill(level, set, block - set->block);
+}
+
+/* An invalid block if there is one, else the one the policy replaces */
+cacheBlock* choose_victim(cacheLevel* level, cacheSet* set)
+{
+  unsigned int i;
+
+  for(i = 0; i < level->assoc; i++)
+    if(set->block[i].valid == INVALID)
+      return &set->block[i];
+  return &set->block[level->replacement->victim(level, set)];
+}
+
+/*
+  Remove the size bytes at addr from every level above this one, copying
+  any dirty data they hold into data. Returns nonzero if there was any.
+*/
+static int back_invalidate(cacheLevel* level, address addr, unsigned int size, byte* data)
+{
+  cacheLevel* above;
+  cacheBlock* block;
+  cacheBlock* entry;
+  unsigned int offset;
+  int dirty = 0;
+  int merged;
+  int i;
+
+  for(i = 0; i < 2; i++)
+  {
+    above = level->above[i];
+    if(above == NULL)
+      continue;
+
+    for(offset = 0; offset < size; offset += above->block_size)
+    {
+      drop_streamed(above, addr + offset);
+      block = find_block(above, addr + offset);
+
+      /* A dirty block in a victim cache goes first, as any copy above it is newer */
+      entry = victim_lookup(above, addr + offset);
+      if(entry != NULL)
+      {
+        if(block == NULL && entry->dirty == DIRTY)
+        {
+          memcpy(data + offset, entry->data, above->block_size);
+          dirty = 1;
+        }
+        entry->valid = INVALID;
+        entry->dirty = VIRGIN;
+        above->stats.back_invalidations++;
+      }
+
+      merged = back_invalidate(above, addr + offset, above->block_size, block ? block->data : data + offset);
+      if(block != NULL)
+      {
+        if(merged || block->dirty == DIRTY)
+        {
+          memcpy(data + offset, block->data, above->block_size);
+          merged = 1;
+        }
+        if(block->prefetched)
+          above->stats.useless_prefetches++;
+        block->valid = INVALID;
+        block->dirty = VIRGIN;
+        block->prefetched = 0;
+        above->stats.back_invalidations++;
+      }
+      dirty |= merged;
+    }
+  }
+  return dirty;
+}
+
+static void write_below(cacheLevel* level, address addr, byte* data, unsigned int size);
+static void access_level(cacheLevel* level, address addr, byte* data, unsigned int size, WriteEnable we);
+
+/*
+  Place size bytes evicted from above into an exclusive level. A whole
+  block is allocated; part of one only updates a block already here and
+  otherwise goes further down if it is dirty.
+*/
+static void install(cacheLevel* level, address addr, byte* data, unsigned int size, int dirty)
+{
+  unsigned int index = set_index(level, addr);
+  cacheBlock* block = find_block(level, addr);
+
+  level->hierarchy->latency += level->hit_latency;
+  drop_streamed(level, addr);
+  if(block == NULL)
+  {
+    if(size != level->block_size)
+    {
+      if(dirty)
+        write_below(level, addr, data, size);
+      return;
+    }
+    block = choose_victim(level, &level->sets[index]);
+    evict(level, index, block);
+    block->tag = tag_of(level, addr);
+    filled(level, index, block);
+  }
+  else
+    touch(level, index, block);
+
+  /* A clean copy of a block already here may be stale */
+  if(dirty || block->valid == INVALID)
+    memcpy(block->data + (addr & (level->block_size - 1)), data, size);
+  block->valid = VALID;
+  if(dirty && level->memory_sync_policy == WRITE_THROUGH)
+    write_below(level, addr, data, size);
+  else if(dirty)
+    block->dirty = DIRTY;
+}
+
+/*
+  Write size bytes to whatever is below this level. Exclusive levels
+  only update a copy they already hold, so the data is never in two
+  places.
+*/
+static void write_below(cacheLevel* level, address addr, byte* data, unsigned int size)
+{
+  cacheLevel* next = level->next;
+  cacheBlock* block;
+
+  if(next == NULL)
+  {
+    access_dram(level->hierarchy, addr, data, size, WRITE);
+    return;
+  }
+  if(next->inclusion != EXCLUSIVE)
+  {
+    access_level(next, addr, data, size, WRITE);
+    return;
+  }
+
+  next->hierarchy->latency += next->hit_latency;
+  drop_streamed(next, addr);
+  block = find_block(next, addr);
+  if(block != NULL)
+  {
+    memcpy(block->data + (addr & (next->block_size - 1)), data, size);
+    if(next->memory_sync_policy == WRITE_BACK)
+    {
+      block->dirty = DIRTY;
+      return;
+    }
+  }
+  write_below(next, addr, data, size);
+}
+
+/*
+  Read size bytes from below this level into data. An exclusive level
+  below gives up its copy when it holds the whole block, and reports
+  whether the copy was dirty. It keeps the copy when take is 0, as for
+  the L1 instruction cache, whose clean blocks could be stale by the time
+  they would be returned.
+*/
+static int read_below(cacheLevel* level, address addr, byte* data, unsigned int size, int take)
+{
+  cacheLevel* next = level->next;
+  cacheBlock* block;
+  int dirty;
+
+  if(next == NULL)
+  {
+    access_dram(level->hierarchy, addr, data, size, READ);
+    return 0;
+  }
+  if(next->inclusion != EXCLUSIVE)
+  {
+    access_level(next, addr, data, size, READ);
+    return 0;
+  }
+
+  next->stats.reads++;
+  next->hierarchy->latency += next->hit_latency;
+  block = find_block(next, addr);
+  count_access(next, addr, block == NULL);
+  if(block == NULL)
+  {
+    next->stats.read_misses++;
+    return read_below(next, addr, data, size, take);
+  }
+
+  memcpy(data, block->data + (addr & (next->block_size - 1)), size);
+  if(!take || size != next->block_size)
+  {
+    touch(next, set_index(next, addr), block);
+    return 0;
+  }
+  dirty = block->dirty == DIRTY;
+  block->valid = INVALID;
+  block->dirty = VIRGIN;
+  return dirty;
+}
+
+/* Send a block leaving level to the level below, if it must go there */
+static void send_below(cacheLevel* level, address addr, byte* data, int dirty)
+{
+  if(level->next != NULL && level->next->inclusion == EXCLUSIVE)
+  {
+    /* The L1 instruction cache only ever copies from an exclusive level */
+    if(level == &level->hierarchy->level[L1I])
+      return;
+    if(dirty)
+    {
+      level->stats.writebacks++;
+      count_writeback(level, addr);
+    }
+    install(level->next, addr, data, level->block_size, dirty);
+  }
+  else if(dirty)
+  {
+    level->stats.writebacks++;
+    count_writeback(level, addr);
+    write_below(level, addr, data, level->block_size);
+  }
+}
+
+/* Put a block level is evicting into its victim cache, sending the one it displaces below */
+static void keep_victim(cacheLevel* level, address addr, byte* data, int dirty)
+{
+  cacheBlock* entry = victim_slot(level);
+  byte old[MAX_BLOCK_SIZE];
+  int old_dirty;
+
+  if(entry->valid == VALID)
+  {
+    /* Free the entry first, so nothing below finds it while its block goes down */
+    old_dirty = entry->dirty == DIRTY;
+    memcpy(old, entry->data, level->block_size);
+    entry->valid = INVALID;
+    entry->dirty = VIRGIN;
+    send_below(level, victim_address(level, entry), old, old_dirty);
+  }
+  entry->tag = addr >> level->offset_bits;
+  memcpy(entry->data, data, level->block_size);
+  entry->dirty = dirty ? DIRTY : VIRGIN;
+  entry->valid = VALID;
+  victim_used(level, entry);
+}
+
+/*
+  If level's victim or miss cache holds the block at addr, copy it into
+  data, setting *dirty, and return nonzero. A victim cache gives the
+  block up; a miss cache keeps its copy.
+*/
+static int recover_victim(cacheLevel* level, address addr, byte* data, int* dirty)
+{
+  cacheBlock* entry = victim_lookup(level, addr);
+
+  if(entry == NULL)
+    return 0;
+  memcpy(data, entry->data, level->block_size);
+  if(level->victim == VICTIM_CACHE)
+  {
+    *dirty = entry->dirty == DIRTY;
+    entry->valid = INVALID;
+    entry->dirty = VIRGIN;
+  }
+  else
+    victim_used(level, entry);
+  level->stats.victim_hits++;
+  return 1;
+}
+
+/* Put a clean copy of a block just fetched from below into level's miss cache */
+static void keep_missed(cacheLevel* level, address addr, byte* data)
+{
+  cacheBlock* entry = victim_slot(level);
+
+  entry->tag = addr >> level->offset_bits;
+  memcpy(entry->data, data, level->block_size);
+  entry->dirty = VIRGIN;
+  entry->valid = VALID;
+  victim_used(level, entry);
+}
+
+/* Send a block being replaced to the victim cache or the level below */
+static void evict(cacheLevel* level, unsigned int index, cacheBlock* block)
+{
+  cacheBlock* entry;
+  address addr;
+
+  if(block->valid == INVALID)
+    return;
+
+  addr = block_address(level, index, block);
+  level->stats.evictions++;
+  count_eviction(level, addr);
+  if(block->prefetched)
+    level->stats.useless_prefetches++;
+  block->prefetched = 0;
+  if(level->inclusion == INCLUSIVE && back_invalidate(level, addr, level->block_size, block->data))
+    block->dirty = DIRTY;
+
+  if(level->victims != NULL && level->victim == VICTIM_CACHE)
+    keep_victim(level, addr, block->data, block->dirty == DIRTY);
+  else
+  {
+    /* The miss cache's copy must not be older than what goes below, or
+       stay at all if the block moves down to an exclusive level */
+    if((entry = victim_lookup(level, addr)) != NULL)
+    {
+      if(level->next != NULL && level->next->inclusion == EXCLUSIVE && level != &level->hierarchy->level[L1I])
+        entry->valid = INVALID;
+      else
+        memcpy(entry->data, block->data, level->block_size);
+    }
+    send_below(level, addr, block->data, block->dirty == DIRTY);
+  }
+
+  block->valid = INVALID;
+  block->dirty = VIRGIN;
+}
+
+/* Read or write size bytes at addr, which lie within one block of this level */
+static void access_level(cacheLevel* level, address addr, byte* data, unsigned int size, WriteEnable we)
+{
+  unsigned int index = set_index(level, addr);
+  unsigned int offset = addr & (level->block_size - 1);
+  cacheBlock* block = find_block(level, addr);
+  CacheAction action = HIT;
+  byte fill[MAX_BLOCK_SIZE];
+  int dirty = 0;
+  int prefetched = 0;
+
+  level->hierarchy->latency += level->hit_latency;
+  if(we == READ)
+    level->stats.reads++;
+  else
+    level->stats.writes++;
+
+  if(block == NULL)
+  {
+    /* A block in the victim cache, miss cache or a stream buffer is a hit there */
+    if(!recover_victim(level, addr - offset, fill, &dirty) && !take_streamed(level, addr - offset, fill))
+    {
+      action = MISS;
+      if(we == READ)
+        level->stats.read_misses++;
+      else
+        level->stats.write_misses++;
+
+      /* Fetch before evicting, so the victim can't displace the block below */
+      dirty = read_below(level, addr - offset, fill, level->block_size, level != &level->hierarchy->level[L1I]);
+      if(dirty && level->memory_sync_policy == WRITE_THROUGH)
+      {
+        write_below(level, addr - offset, fill, level->block_size);
+        dirty = 0;
+      }
+      if(level->victims != NULL && level->victim == MISS_CACHE)
+        keep_missed(level, addr - offset, fill);
+    }
+    block = choose_victim(level, &level->sets[index]);
+    evict(level, index, block);
+    memcpy(block->data, fill, level->block_size);
+    block->dirty = dirty ? DIRTY : VIRGIN;
+    block->tag = tag_of(level, addr);
+    block->valid = VALID;
+    filled(level, index, block);
+  }
+  else
+  {
+    if(block->prefetched)
+    {
+      prefetched = 1;
+      level->stats.useful_prefetches++;
+      level->stats.prefetch_lead += level->stats.reads + level->stats.writes - block->prefetch_time;
+      block->prefetched = 0;
+    }
+    touch(level, index, block);
+  }
+
+  if(we == READ)
+    memcpy(data, block->data + offset, size);
+  else
+  {
+    memcpy(block->data + offset, data, size);
+    if(level->memory_sync_policy == WRITE_BACK)
+      block->dirty = DIRTY;
+    else
+      write_below(level, addr, data, size);
+  }
+
+  if(level == &hierarchy.level[L1D] && IS_GUI_ACTIVE())
+    highlight_offset(index, block - level->sets[index].block, offset, action);
+
+  count_access(level, addr, action == MISS);
+  if(level->prefetcher != NULL)
+    prefetch_access(level, addr, action == MISS, prefetched);
+}
+
+/* Nonzero if level, or its victim or miss cache, holds the block at addr */
+int level_holds(cacheLevel* level, address addr)
+{
+  return find_block(level, addr) != NULL || victim_lookup(level, addr) != NULL;
+}
+
+/* Copy the block at addr from below level, without placing it in level */
+void copy_from_below(cacheLevel* level, address addr, byte* data)
+{
+  read_below(level, addr, data, level->block_size, 0);
+}
+
+/*
+  Bring the block at addr into level for a prefetcher, unless it is
+  already here or in its victim or miss cache. Returns nonzero if it was fetched.
+*/
+int prefetch_block(cacheLevel* level, address addr)
+{
+  unsigned int index = set_index(level, addr);
+  byte fill[MAX_BLOCK_SIZE];
+  cacheBlock* block;
+  int dirty;
+
+  if(level_holds(level, addr))
+    return 0;
+
+  dirty = read_below(level, addr, fill, level->block_size, level != &level->hierarchy->level[L1I]);
+  if(dirty && level->memory_sync_policy == WRITE_THROUGH)
+  {
+    write_below(level, addr, fill, level->block_size);
+    dirty = 0;
+  }
+  block = choose_victim(level, &level->sets[index]);
+  evict(level, index, block);
+  memcpy(block->data, fill, level->block_size);
+  block->dirty = dirty ? DIRTY : VIRGIN;
+  block->tag = tag_of(level, addr);
+  block->valid = VALID;
+  block->prefetched = 1;
+  block->prefetch_time = level->stats.reads + level->stats.writes;
+  filled(level, index, block);
+  level->stats.prefetches++;
+  return 1;
+}
+
+/*
+  Read or write the word at addr through the hierarchy, starting at the
+  L1 cache for the kind of access. The address must be word aligned.
+*/
+void access_hierarchy(cacheHierarchy* h, AccessKind kind, address addr, word* data, WriteEnable we)
+{
+  h->type = kind == INSTRUCTION_FETCH ? TYPE_FETCH : (we == WRITE ? TYPE_WRITE : TYPE_READ);
+  h->latency = 0;
+  if(h->profile != NULL && (h->profile_kinds & 1 << kind))
+    stack_distance_access(h->profile, addr);
+  if(h->first[kind] == NULL)
+    access_dram(h, addr, (byte*)data, sizeof(word), we);
+  else
+    access_level(h->first[kind], addr, (byte*)data, sizeof(word), we);
+  record_access(h, kind, h->latency);
+  if(h->pending_count != 0)
+    issue_prefetches(h);
+  tick_write_buffer(h);
+}
+
+static char* inclusion_name(InclusionPolicy p)
+{
+  return p == INCLUSIVE ? "inclusive" : (p == EXCLUSIVE ? "exclusive" : "non-inclusive");
+}
+
+void print_hierarchy(cacheHierarchy* h, FILE* out)
+{
+  cacheLevel* level;
+  char prefetch[100];
+  char victim[100];
+  char buffer[100];
+  int i;
+
+  for(i = 0; i < LEVEL_COUNT; i++)
+  {
+    level = &h->level[i];
+    if(!level_present(level))
+      fprintf(out, "%-4s none\n", level->name);
+    else
+    {
+      describe_prefetcher(level, prefetch);
+      describe_victim_cache(level, victim);
+      fprintf(out, "%-4s %u sets x %u ways x %u bytes = %u bytes, %s, %s, %u-cycle hit%s%s%s%s%s%s\n",
+              level->name, level->set_count, level->assoc, level->block_size,
+              level->set_count * level->assoc * level->block_size, policy_name(level->policy),
+              level->memory_sync_policy == WRITE_BACK ? "write back" : "write through", level->hit_latency,
+              i >= L2 ? ", " : "", i >= L2 ? inclusion_name(level->inclusion) : "",
+              prefetch[0] ? ", " : "", prefetch, victim[0] ? ", " : "", victim);
+    }
+  }
+  fprintf(out, "DRAM %u cycles, then %u bytes a cycle\n", h->dram_latency, h->dram_bandwidth);
+  if(h->write_buffer.entries != 0)
+  {
+    describe_write_buffer(h, buffer);
+    fprintf(out, "Write buffer %s\n", buffer);
+  }
+}
+
+static double ratio(unsigned long long part, unsigned long long whole)
+{
+  return whole ? (double)part / whole : 0.0;
+}
+
+void print_hierarchy_stats(cacheHierarchy* h, FILE* out)
+{
+  cacheLevel* level;
+  cacheStats* s;
+  int i;
+
+  fprintf(out, "Level      Reads   R-Miss      Writes   W-Miss  Miss-Rate   Evicts  Wr-Backs  Back-Inv\n");
+  for(i = 0; i < LEVEL_COUNT; i++)
+  {
+    level = &h->level[i];
+    if(!level_present(level))
+      continue;
+    s = &level->stats;
+    fprintf(out, "%-5s %10llu %8llu  %10llu %8llu  %8.4f  %8llu  %8llu  %8llu\n",
+            level->name, s->reads, s->read_misses, s->writes, s->write_misses,
+            ratio(s->read_misses + s->write_misses, s->reads + s->writes),
+            s->evictions, s->writebacks, s->back_invalidations);
+  }
+  fprintf(out, "DRAM  %10llu bytes read, %llu bytes written\n", h->dram_reads, h->dram_writes);
+  print_prefetch_stats(h, out);
+  print_victim_stats(h, out);
+  print_write_buffer_stats(h, out);
+  print_detail_stats(h, out);
+  print_timing_stats(h, out);
+}
@@ -0,0 +1,124 @@
+#include "tips.h"
+
+/*
+  Simulator event log. Every instruction and DRAM access is recorded,
+  unformatted, in a ring buffer of the last log_keep events, which print
+  log writes out when something has gone wrong. Events are only
+  formatted and shown as they happen if log_level asks for them, so runs
+  at the summary level or below do no formatting or output per event.
+*/
+
+#define DEFAULT_LOG_KEEP 4096
+
+typedef enum {EVENT_INSTRUCTION, EVENT_DRAM_READ, EVENT_DRAM_WRITE} LogEvent;
+
+typedef struct {
+  LogEvent kind;
+  address addr;                 /* PC of an instruction, else the DRAM address */
+  word value;                   /* the instruction, or the bytes transferred */
+} logEntry;
+
+LogLevel log_level;
+
+static logEntry* ring;
+static unsigned int ring_size;
+static unsigned long long logged;   /* events recorded since the log was cleared */
+
+static void record(logEntry* e)
+{
+  if(ring == NULL)
+    set_log_keep(DEFAULT_LOG_KEEP);
+  if(ring_size != 0)
+    ring[logged % ring_size] = *e;
+  logged++;
+}
+
+static void format_entry(logEntry* e, char* buffer)
+{
+  int n;
+
+  switch(e->kind)
+  {
+  case EVENT_INSTRUCTION:
+    n = sprintf(buffer, "[0x%08X]: 0x%08X\t", e->addr, e->value);
+    disassemble_inst(e->value, e->addr, buffer + n);
+    break;
+  case EVENT_DRAM_READ:
+    sprintf(buffer, "Accessing %u bytes at 0x%08X\n", e->value, e->addr);
+    break;
+  case EVENT_DRAM_WRITE:
+    sprintf(buffer, "Updating %u bytes at 0x%08X\n", e->value, e->addr);
+    break;
+  }
+}
+
+static void show(logEntry* e)
+{
+  char buffer[200];
+
+  format_entry(e, buffer);
+  append_log(buffer);
+}
+
+/* Record the execution of inst, fetched from pc */
+void log_instruction(address pc, word inst)
+{
+  logEntry e = { EVENT_INSTRUCTION, pc, inst };
+
+  record(&e);
+  if(log_level >= LOG_INSTRUCTION)
+    show(&e);
+}
+
+/* Record a DRAM transfer of size bytes at addr */
+void log_dram(address addr, int size, WriteEnable flag)
+{
+  logEntry e = { flag == READ ? EVENT_DRAM_READ : EVENT_DRAM_WRITE, addr, size };
+
+  record(&e);
+  if(log_level >= LOG_ACCESS)
+    show(&e);
+}
+
+/* Keep the last n events, discarding those recorded so far */
+void set_log_keep(unsigned int n)
+{
+  free(ring);
+  ring_size = n;
+  logged = 0;
+  ring = malloc(sizeof(logEntry) * (n ? n : 1));
+  if(ring == NULL)
+  {
+    fprintf(stderr, "Unable to allocate the event log\n");
+    exit(1);
+  }
+}
+
+/* Write the last n events recorded, oldest first, or all that are kept if n is 0 */
+void dump_log(FILE* out, unsigned int n)
+{
+  char buffer[200];
+  unsigned long long i;
+  unsigned long long kept = logged < ring_size ? logged : ring_size;
+
+  if(n == 0 || n > kept)
+    n = kept;
+  fprintf(out, "Last %u of %llu events:\n", n, logged);
+  for(i = logged - n; i < logged; i++)
+  {
+    format_entry(&ring[i % ring_size], buffer);
+    fputs(buffer, out);
+  }
+}
+
+/* Parse a log level name, returning -1 if it isn't one */
+int parse_log_level(const char* name)
+{
+  static char* names[] = { "off", "summary", "access", "instruction" };
+  int i;
+
+  for(i = 0; i <= LOG_INSTRUCTION; i++)
+    if(strcmp(name, names[i]) == 0)
+      return i;
+  return -1;
+}
@@ -1,7 +1,8 @@
 #include "tips.h"
 
 /* Define Cache Parameters */
-cacheSet cache[MAX_SETS];
+cacheSet* cache;
+cacheHierarchy hierarchy;
 unsigned int block_size;
 unsigned int set_count;
 unsigned int assoc;
@@ -11,26 +12,32 @@ MemorySyncPolicy memory_sync_policy;
 
 void init_memory() 
 {
-  flush_cache();
+  init_hierarchy(&hierarchy);
+  allocate_cache();
 }
 
-void flush_cache() 
+/*
+  Make the hierarchy's L1 data cache match the cache parameters above,
+  reallocate every level and flush them.
+*/
+void allocate_cache()
 {
-  int set_index;
-  int block_index;
+  cacheLevel* l1d = &hierarchy.level[L1D];
 
-  /* for each set */
-  for( set_index=0; set_index < set_count; set_index++ )
-  {
-    /* for each block in the set */
-    for( block_index=0; block_index < assoc; block_index++ ) 
-    {
-      cache[set_index].block[block_index].valid = INVALID;
-      cache[set_index].block[block_index].dirty = VIRGIN;
-      init_lru(set_index, block_index);
-      init_lfu(set_index, block_index);
-    }
-  }
+  l1d->set_count = set_count;
+  l1d->assoc = assoc;
+  l1d->block_size = block_size;
+  l1d->policy = policy;
+  l1d->memory_sync_policy = memory_sync_policy;
+  allocate_hierarchy(&hierarchy);
+  cache = l1d->sets;
+  allocate_cores();
+}
+
+void flush_cache() 
+{
+  flush_hierarchy(&hierarchy);
+  flush_cores();
 }
 
 static int translateAddress(address virtual_addr, address* physical_addr)
@@ -68,18 +75,14 @@ static int translateAddress(address virtual_addr, address* physical_addr)
 int accessDRAM(address addr, byte* data, TransferUnit mode, WriteEnable flag)
 {
   static byte DRAM[PHYSICAL_PAGE_COUNT * PHYSICAL_PAGE_SIZE];
-  static char* reading = "Accessing";
-  static char* writing = "Updating";
 #ifdef CYGWIN
   static instruction self_branch = 0xffff0010;
 #else
   static instruction self_branch = 0x0100ffff;
 #endif
-  char buffer[200];
   int transfer_size;
   address phys_addr;
   int error = 0;
-  char* memory_action;
   
   /* Determine number of bytes involved in memory access */
   switch(mode)
@@ -102,6 +105,12 @@ int accessDRAM(address addr, byte* data, TransferUnit mode, WriteEnable flag)
   case OCTWORD_SIZE:
     transfer_size = 32;
     break;
+  case SIXTEEN_WORD_SIZE:
+    transfer_size = 64;
+    break;
+  case THIRTYTWO_WORD_SIZE:
+    transfer_size = 128;
+    break;
   default:
     append_log("Invalid transfer mode for accessDRAM\nDefaulting to moving only 1 byte");
     error = 1;
@@ -120,11 +129,9 @@ int accessDRAM(address addr, byte* data, TransferUnit mode, WriteEnable flag)
   {
   case READ:        
     memcpy(data, DRAM + phys_addr, transfer_size);
-    memory_action = reading;
     break;
   case WRITE:
     memcpy(DRAM + phys_addr, data, transfer_size);
-    memory_action = writing;
     break;
   default:
     append_log("Invalid flag for accessDRAM\n");
@@ -132,11 +139,8 @@ int accessDRAM(address addr, byte* data, TransferUnit mode, WriteEnable flag)
   }
 
   /* Announce memory access */
-  sprintf(buffer, "%s %u bytes at 0x%08X\n", memory_action, transfer_size, addr);
-  if(!IS_GUI_ACTIVE())
-    printf(buffer);
-  else
-    append_log(buffer);
+  if(flag == READ || flag == WRITE)
+    log_dram(addr, transfer_size, flag);
 
   return error;
 }
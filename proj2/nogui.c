@@ -174,13 +174,74 @@ void display_help()
   printf("config <set_count> <assoc> <block_size> <Replacement Policy> <Sync Policy> --\n");
   printf("  Set cache to have <set_count> sets (i.e. number of unique indexes), <assoc>\n");
   printf("  blocks per setm with each block to have size <block_size>. <Replacment\n");
-  printf("  Policy> is either 'lru' for LRU, 'r' for RANDOM, or 'lfu' for LFU.\n");
+  printf("  Policy> is 'lru' for LRU, 'r' for RANDOM, 'lfu' for LFU (ties go to the\n");
+  printf("  LRU block), 'plru' for tree pseudo-LRU or 'nru' for not recently used.\n");
   printf("  <Sync Policy> is either 'wb' for WRITE_BACK or 'wt' for WRITE_THROUGH\n");
+  printf("  Up to %d sets, %d blocks per set and %d byte blocks are allowed\n", MAX_SETS, MAX_ASSOC, MAX_BLOCK_SIZE);
+  printf("\n");
+  printf("level <level> <set_count> <assoc> <block_size> <Replacement Policy> <Sync Policy>\n");
+  printf("  [<Inclusion>] -- Configure cache <level>: 'l1i', 'l1d', 'l2' or 'l3'. The\n");
+  printf("  parameters are as for config, which sets up l1d. A set count of 0 removes\n");
+  printf("  the level. <Inclusion> applies to l2 and l3 and is 'inclusive',\n");
+  printf("  'exclusive' or 'noninclusive' (the default)\n");
+  printf("\n");
+  printf("prefetch <level> <none|next|stride|stream> [<degree>] [<distance>] --\n");
+  printf("  Prefetch into cache <level>. 'next' fetches <degree> blocks from\n");
+  printf("  <distance> blocks ahead on a miss or the first use of a prefetched\n");
+  printf("  block. 'stride' does the same in strides learned per instruction, once\n");
+  printf("  one repeats; traces have no instructions, so trace and sweep runs\n");
+  printf("  ignore it. 'stream' keeps <distance> stream buffers of <degree>\n");
+  printf("  blocks, started on misses. The cache is flushed\n");
+  printf("\n");
+  printf("victim <level> <none|victim|miss> [<entries>] -- Put a fully associative\n");
+  printf("  buffer of <entries> blocks (4 by default, up to %d) beside cache\n", MAX_VICTIM_ENTRIES);
+  printf("  <level>. 'victim' keeps the blocks it evicts, 'miss' a copy of those it\n");
+  printf("  fetches; misses found there are recovered. Exclusive levels ignore it.\n");
+  printf("  The cache is flushed\n");
+  printf("\n");
+  printf("writebuffer <entries> [eager|lazy] [<interval>] -- Hold writes to DRAM in\n");
+  printf("  a buffer of up to %d block-sized <entries>, merging writes to the same\n", MAX_WRITE_BUFFER_ENTRIES);
+  printf("  block. DRAM takes the oldest every <interval> accesses (4 by default),\n");
+  printf("  whenever there is one ('eager', the default) or once it is half full\n");
+  printf("  ('lazy'). 0 entries removes it. The cache is flushed\n");
+  printf("\n");
+  printf("profile <block_size> [data|fetch|all] -- Profile LRU stack distances of\n");
+  printf("  data accesses, instruction fetches or both (the default) in blocks of\n");
+  printf("  <block_size> bytes, for print curve. 'profile off' stops\n");
+  printf("\n");
+  printf("latency <level> <cycles> -- Make an access to cache <level> take\n");
+  printf("  <cycles>, hit or miss (l1i and l1d 1, l2 10 and l3 30 to start)\n");
+  printf("\n");
+  printf("latency dram <cycles> [<bytes per cycle>] -- Make a DRAM transfer take\n");
+  printf("  <cycles> plus a cycle per <bytes per cycle> moved (100 and 8 to start)\n");
+  printf("\n");
+  printf("detail <on|off> -- Count hits, misses, evictions and write backs per\n");
+  printf("  set and per access type, DRAM bytes per access type, and classify\n");
+  printf("  misses as compulsory, capacity or conflict, for print stats and print\n");
+  printf("  sets. The cache is flushed\n");
+  printf("\n");
+  printf("cores <count> [mesi|moesi] -- Run the program on <count> cores (up to\n");
+  printf("  %d), each starting with its number in $a0 and its own %d bytes of\n", MAX_CORES, CORE_STACK_SIZE);
+  printf("  stack, an instruction each in turn. Each has a private write-back copy\n");
+  printf("  of the L1 data cache, kept coherent over a snooping bus by MESI (the\n");
+  printf("  default) or MOESI; the other levels are not used. 1 goes back to one\n");
+  printf("  processor. PCs are reset and the caches flushed\n");
+  printf("\n");
+  printf("log <level> -- Show 'off': nothing as it runs, 'summary': a line per\n");
+  printf("  step or run command (the default), 'access': also every DRAM access, or\n");
+  printf("  'instruction': also every instruction\n");
+  printf("\n");
+  printf("log keep <N> -- Keep the last <N> events (4096 to start) for print log\n");
+  printf("\n");
+  printf("trace <file> -- Run the address trace in <file> (Dinero din text or\n");
+  printf("  binary from sim -t) through the cache and print statistics. The\n");
+  printf("  cache is flushed before and after\n");
   printf("\n");
   printf("view <mode> -- change how cache is drawn. <mode> is either 'index' for\n");
   printf("  index-based view of cache or 'assoc' for associativity-based view\n");
   printf("\n");
-  printf("step N -- Step the program for N instructions\n");
+  printf("step N -- Step the program for N instructions, on each core if there\n");
+  printf("  are several\n");
   printf("\n");
   printf("run <time>-- Start automated simulation with instructions executing\n");
   printf("  every <time> milliseconds. Press Ctrl-C to stop the simulation\n");
@@ -189,6 +250,20 @@ void display_help()
   printf("\n");
   printf("print cache -- Print the current cache state\n");
   printf("\n");
+  printf("print levels -- Print the configuration of each cache level\n");
+  printf("\n");
+  printf("print stats -- Print hit and miss statistics for each cache level, or\n");
+  printf("  for each core and the bus if there are several\n");
+  printf("\n");
+  printf("print sets <level> -- Print the detailed statistics of each set used in\n");
+  printf("  cache <level>\n");
+  printf("\n");
+  printf("print log [N] -- Print the last [N] instructions and DRAM accesses kept,\n");
+  printf("  whatever the log level\n");
+  printf("\n");
+  printf("print curve -- Print the LRU miss ratio of every cache size and\n");
+  printf("  associativity for the accesses profiled since the cache was flushed\n");
+  printf("\n");
   printf("reset cpu -- Reset the PC and $sp back to startup values\n");
   printf("\n");
   printf("reset cache -- Flush the cache\n");
@@ -198,65 +273,60 @@ void display_help()
   printf("help -- List top-level commands\n");
 }
 
-void configure_cache(StringTokenizer* tokenizer)
+/*
+  Read "<set_count> <assoc> <block_size> <Replacement Policy> <Sync Policy>"
+  for the config and level commands. Returns 0 on success.
+*/
+int read_cache_parameters(StringTokenizer* tokenizer, int* index, int* associativity, int* block, ReplacementPolicy* p, MemorySyncPolicy* m)
 {
-  int assoc;
-  int index;
-  int block;
-  ReplacementPolicy p;
-  MemorySyncPolicy m;
   char* command;
 
   /* Get index */
   command = nextToken(tokenizer);
   if(strlen(command) != 0)
-    index = atoi(command);
+    *index = atoi(command);
   else
   {
     printf("Insufficient arguments\n");
-    return;
+    return -1;
   }
 
   /* Get assoc */
   command = nextToken(tokenizer);
   if(strlen(command) != 0)
-    assoc = atoi(command);
+    *associativity = atoi(command);
   else
   {
     printf("Insufficient arguments\n");
-    return;
+    return -1;
   }
 
   /* Get block */
   command = nextToken(tokenizer);
   if(strlen(command) != 0)
-    block = atoi(command);
+    *block = atoi(command);
   else
   {
     printf("Insufficient arguments\n");
-    return;
+    return -1;
   }
 	
   /* Get replacement policy */
   command = nextToken(tokenizer);
   if(strlen(command) != 0)
   {
-    if(strcmp(command, "lru") == 0)
-      p = LRU;
-    else if(strcmp(command, "r") == 0)
-      p = RANDOM;
-    else if(strcmp(command, "lfu") == 0)
-      p = LFU;
+    if(parse_replacement_policy(command) >= 0)
+      *p = parse_replacement_policy(command);
     else
     {
       printf("Invalid parameter for Replacement Policy\n");
-      return;
+      return -1;
     }
   }
   else
   {
     printf("Insufficient arguments\n");
-    return;
+    return -1;
   }
 
   /* Get memory sync policy */
@@ -264,27 +334,112 @@ void configure_cache(StringTokenizer* tokenizer)
   if(strlen(command) != 0)
   {
     if(strcmp(command, "wb") == 0)
-      m = WRITE_BACK;
+      *m = WRITE_BACK;
     else if(strcmp(command, "wt") == 0)
-      m = WRITE_THROUGH;
+      *m = WRITE_THROUGH;
     else
     {
       printf("Invalid parameter for Memory Sync Policy\n");
-      return;
+      return -1;
     }
   }
   else
   {
     printf("Insufficient arguments\n");
-    return;
+    return -1;
   }
 
-  validate_cache_parameters(index, assoc, block);      
+  return 0;
+}
+
+void configure_cache(StringTokenizer* tokenizer)
+{
+  int associativity;
+  int index;
+  int block;
+  ReplacementPolicy p;
+  MemorySyncPolicy m;
+
+  if(read_cache_parameters(tokenizer, &index, &associativity, &block, &p, &m) != 0)
+    return;
+
   policy = p;
   memory_sync_policy = m;
+  validate_cache_parameters(index, associativity, block);      
 
-  //I'm probably making this way too ugly with the additional check for LFU
-  printf("\nCache parameters changed:\n + set count = %d\n + associativity = %d\n + block size = %d\n + replacement policy = %s\n + memory sync policy = %s\n", set_count, assoc, block_size, (policy == RANDOM ? "Random" : (policy == LRU ? "LRU" : "LFU")), (memory_sync_policy == WRITE_BACK ? "Write Back" : "Write Through"));
+  printf("\nCache parameters changed:\n + set count = %d\n + associativity = %d\n + block size = %d\n + replacement policy = %s\n + memory sync policy = %s\n + cache size = %u bytes\n", set_count, assoc, block_size, policy_name(policy), (memory_sync_policy == WRITE_BACK ? "Write Back" : "Write Through"), set_count * assoc * block_size);
+}
+
+/* The level named by the next token, printing an error and returning -1 if there isn't one */
+int level_named(char* name)
+{
+  static char* names[LEVEL_COUNT] = { "l1i", "l1d", "l2", "l3" };
+  int n;
+
+  for(n = 0; n < LEVEL_COUNT; n++)
+    if(strcmp(name, names[n]) == 0)
+      return n;
+  return -1;
+}
+
+int read_level(StringTokenizer* tokenizer)
+{
+  int n = level_named(nextToken(tokenizer));
+
+  if(n < 0)
+    printf("Invalid cache level: use l1i, l1d, l2 or l3\n");
+  return n;
+}
+
+void configure_level(StringTokenizer* tokenizer)
+{
+  cacheLevel* level;
+  int associativity;
+  int index;
+  int block;
+  int n;
+  ReplacementPolicy p;
+  MemorySyncPolicy m;
+  InclusionPolicy inclusion = NON_INCLUSIVE;
+  char* command;
+
+  /* Get level */
+  if((n = read_level(tokenizer)) < 0)
+    return;
+
+  if(read_cache_parameters(tokenizer, &index, &associativity, &block, &p, &m) != 0)
+    return;
+
+  /* Get inclusion policy, if any */
+  command = nextToken(tokenizer);
+  if(strcmp(command, "inclusive") == 0)
+    inclusion = INCLUSIVE;
+  else if(strcmp(command, "exclusive") == 0)
+    inclusion = EXCLUSIVE;
+  else if(strlen(command) != 0 && strcmp(command, "noninclusive") != 0)
+  {
+    printf("Invalid parameter for Inclusion Policy\n");
+    return;
+  }
+
+  if(n == L1D)
+  {
+    policy = p;
+    memory_sync_policy = m;
+    validate_cache_parameters(index, associativity, block);
+  }
+  else
+  {
+    level = &hierarchy.level[n];
+    level->policy = p;
+    level->memory_sync_policy = m;
+    level->inclusion = n >= L2 ? inclusion : NON_INCLUSIVE;
+    validate_level_parameters(level, index, associativity, block);
+    allocate_cache();
+  }
+
+  printf("\nCache hierarchy changed:\n");
+  print_hierarchy(&hierarchy, stdout);
 }
 
 void do_step(StringTokenizer* tokenizer)
@@ -301,7 +456,17 @@ void do_step(StringTokenizer* tokenizer)
     n = 1;
 
   for(i = 0; i < n; i++)
-    step_processor();
+  {
+    if(bus.count != 0)
+      step_cores();
+    else
+      step_processor();
+  }
+
+  if(log_level >= LOG_SUMMARY && bus.count != 0)
+    printf("Stepped %d instructions on each of %d cores\n", n, bus.count);
+  else if(log_level >= LOG_SUMMARY)
+    printf("Stepped %d instructions, PC = 0x%08X, %llu cycles so far\n", n, PC, hierarchy.timing.cycles);
 }
 
 void start_simulation(StringTokenizer* tokenizer)
@@ -324,114 +489,486 @@ void start_simulation(StringTokenizer* tokenizer)
 
 }
 
-void activate_no_gui(int argc, char** argv)
+void configure_prefetch(StringTokenizer* tokenizer)
 {
-  int console_active = 1;
-  StringTokenizer* tokenizer;
-  char input[200];
+  cacheLevel* level;
   char* command;
-  int speed;
+  int kind;
+  int degree;
+  int distance;
+  int n;
 
-  (void)signal(SIGINT, catch);
-  run_active = 0;
-  
-  printf("Tips v2 Started\n");
+  if((n = read_level(tokenizer)) < 0)
+    return;
+  level = &hierarchy.level[n];
 
-  /* Load file if any */
-  if(argc >= 3)
-    load_dumpfile(argv[argc - 1]);
+  command = nextToken(tokenizer);
+  if((kind = parse_prefetch_kind(command)) < 0)
+  {
+    printf("Invalid prefetcher: use none, next, stride or stream\n");
+    return;
+  }
 
-  while(console_active)
+  /* Stream buffers default to 4 of 4 blocks, the others to the next block */
+  command = nextToken(tokenizer);
+  degree = strlen(command) != 0 ? atoi(command) : (kind == STREAM_PREFETCH ? 4 : 1);
+  command = nextToken(tokenizer);
+  distance = strlen(command) != 0 ? atoi(command) : (kind == STREAM_PREFETCH ? 4 : 1);
+  if(degree < 1 || degree > MAX_PREFETCH_DEGREE)
   {
-    printf("\n[%s] > ", program_name);
-    fgets(input, 200, stdin);
+    printf("Degree must be from 1 to %d\n", MAX_PREFETCH_DEGREE);
+    return;
+  }
+  if(distance < 1 || (kind == STREAM_PREFETCH && distance > MAX_STREAMS))
+  {
+    printf("Distance must be at least 1, and at most %d stream buffers\n", MAX_STREAMS);
+    return;
+  }
+
+  level->prefetch = kind;
+  level->prefetch_degree = degree;
+  level->prefetch_distance = distance;
+  allocate_cache();
+
+  printf("\nCache hierarchy changed:\n");
+  print_hierarchy(&hierarchy, stdout);
+}
+
+void configure_victim(StringTokenizer* tokenizer)
+{
+  cacheLevel* level;
+  char* command;
+  int kind;
+  int entries;
+  int n;
+
+  if((n = read_level(tokenizer)) < 0)
+    return;
+  level = &hierarchy.level[n];
+
+  command = nextToken(tokenizer);
+  if((kind = parse_victim_kind(command)) < 0)
+  {
+    printf("Invalid victim cache: use none, victim or miss\n");
+    return;
+  }
 
-    tokenizer = initTokenizer(input);
+  command = nextToken(tokenizer);
+  entries = strlen(command) != 0 ? atoi(command) : 4;
+  if(entries < 1 || entries > MAX_VICTIM_ENTRIES)
+  {
+    printf("Entries must be from 1 to %d\n", MAX_VICTIM_ENTRIES);
+    return;
+  }
+
+  level->victim = kind;
+  level->victim_entries = entries;
+  allocate_cache();
+
+  printf("\nCache hierarchy changed:\n");
+  print_hierarchy(&hierarchy, stdout);
+}
+
+void configure_write_buffer(StringTokenizer* tokenizer)
+{
+  writeBuffer* wb = &hierarchy.write_buffer;
+  char* command = nextToken(tokenizer);
+  int entries;
+  int drain = DRAIN_EAGER;
+  int interval;
+
+  if(strlen(command) == 0)
+  {
+    printf("Please specify the number of entries.\n");
+    return;
+  }
+  entries = atoi(command);
+  if(entries < 0 || entries > MAX_WRITE_BUFFER_ENTRIES)
+  {
+    printf("Entries must be from 0 to %d\n", MAX_WRITE_BUFFER_ENTRIES);
+    return;
+  }
+
+  command = nextToken(tokenizer);
+  if(strlen(command) != 0 && (drain = parse_drain_policy(command)) < 0)
+  {
+    printf("Invalid drain policy: use eager or lazy\n");
+    return;
+  }
+  command = nextToken(tokenizer);
+  interval = strlen(command) != 0 ? atoi(command) : 4;
+  if(interval < 1)
+  {
+    printf("The interval must be at least 1\n");
+    return;
+  }
+
+  wb->entries = entries;
+  wb->drain = drain;
+  wb->drain_interval = interval;
+  allocate_cache();
+
+  printf("\nCache hierarchy changed:\n");
+  print_hierarchy(&hierarchy, stdout);
+}
+
+void configure_latency(StringTokenizer* tokenizer)
+{
+  char* command = nextToken(tokenizer);
+  int cycles;
+  int bandwidth;
+  int n;
+
+  if(strcmp(command, "dram") == 0)
+  {
+    cycles = atoi(nextToken(tokenizer));
     command = nextToken(tokenizer);
+    bandwidth = strlen(command) != 0 ? atoi(command) : (int)hierarchy.dram_bandwidth;
+    if(cycles < 0 || bandwidth < 1)
+    {
+      printf("Use latency dram <cycles> [<bytes per cycle>], at least 1 byte a cycle\n");
+      return;
+    }
+    hierarchy.dram_latency = cycles;
+    hierarchy.dram_bandwidth = bandwidth;
+  }
+  else
+  {
+    n = level_named(command);
+    if(n < 0 || (cycles = atoi(nextToken(tokenizer))) < 0)
+    {
+      printf("Use latency <l1i|l1d|l2|l3> <cycles> or latency dram <cycles> [<bytes per cycle>]\n");
+      return;
+    }
+    hierarchy.level[n].hit_latency = cycles;
+  }
+
+  /* Only the timing changes, so the cache keeps its contents */
+  printf("\nCache hierarchy changed:\n");
+  print_hierarchy(&hierarchy, stdout);
+}
+
+void configure_cores(StringTokenizer* tokenizer)
+{
+  char* command = nextToken(tokenizer);
+  int count = atoi(command);
+  int protocol = MESI;
+
+  command = nextToken(tokenizer);
+  if(strlen(command) != 0 && (protocol = parse_protocol(command)) < 0)
+  {
+    printf("Invalid protocol: use mesi or moesi\n");
+    return;
+  }
+  if(count < 1 || count > MAX_CORES)
+  {
+    printf("Cores must be from 1 to %d\n", MAX_CORES);
+    return;
+  }
+  if(count > 1 && (set_count == 0 || assoc == 0 || block_size == 0))
+  {
+    printf("The cores' caches copy the L1 data cache; configure one first\n");
+    return;
+  }
+
+  bus.count = count > 1 ? count : 0;
+  bus.protocol = protocol;
+  allocate_cache();
+  reinit_processor();
+
+  if(bus.count != 0)
+    printf("\n%d cores kept coherent by %s; PCs reset and caches flushed\n", bus.count, protocol == MESI ? "MESI" : "MOESI");
+  else
+    printf("\nOne processor; PC reset and cache flushed\n");
+}
+
+void configure_detail(StringTokenizer* tokenizer)
+{
+  char* command = nextToken(tokenizer);
+
+  if(strcmp(command, "on") == 0)
+    hierarchy.detailed = 1;
+  else if(strcmp(command, "off") == 0)
+    hierarchy.detailed = 0;
+  else
+  {
+    printf("Use detail on or detail off\n");
+    return;
+  }
+  allocate_cache();
+  printf("Detailed statistics %s; the cache is flushed\n", hierarchy.detailed ? "on" : "off");
+}
+
+void configure_profile(StringTokenizer* tokenizer)
+{
+  char* command = nextToken(tokenizer);
+  int block;
+  int kinds = 1 << DATA_ACCESS | 1 << INSTRUCTION_FETCH;
 
-    if(strcmp(command, "quit") == 0)
-      console_active = 0;
-    else if(strcmp(command, "exit") == 0)
-      console_active = 0;
-    else if(strcmp(command, "print") == 0 ||
-	    strcmp(command, "display") == 0)
+  if(strcmp(command, "off") == 0)
+  {
+    profile_hierarchy(&hierarchy, 0, 0);
+    printf("Profiling stopped\n");
+    return;
+  }
+
+  block = atoi(command);
+  if(block < 4 || block > MAX_BLOCK_SIZE || (block & (block - 1)) != 0)
+  {
+    printf("Block size must be a power of 2 from 4 to %d\n", MAX_BLOCK_SIZE);
+    return;
+  }
+
+  command = nextToken(tokenizer);
+  if(strcmp(command, "data") == 0)
+    kinds = 1 << DATA_ACCESS;
+  else if(strcmp(command, "fetch") == 0)
+    kinds = 1 << INSTRUCTION_FETCH;
+  else if(strlen(command) != 0 && strcmp(command, "all") != 0)
+  {
+    printf("Invalid parameter: use data, fetch or all\n");
+    return;
+  }
+
+  profile_hierarchy(&hierarchy, block, kinds);
+  printf("Profiling LRU stack distances in %d byte blocks\n", block);
+}
+
+void configure_log(StringTokenizer* tokenizer)
+{
+  char* command = nextToken(tokenizer);
+  int level;
+
+  if(strcmp(command, "keep") == 0)
+  {
+    command = nextToken(tokenizer);
+    if(strlen(command) == 0 || atoi(command) < 0)
     {
-      command = nextToken(tokenizer);
-      if(strcmp(command, "regs") == 0)
-	display_regs();
-      else if(strcmp(command, "cache") == 0)
-	display_cache();
-      else
-	printf("Invalid command: %s\n", input);
+      printf("Please specify how many events to keep.\n");
+      return;
     }
-    else if(strcmp(command, "config") == 0)
-      configure_cache(tokenizer);
-    else if(strcmp(command, "view") == 0)
+    set_log_keep(atoi(command));
+    printf("Keeping the last %d events\n", atoi(command));
+    return;
+  }
+
+  if((level = parse_log_level(command)) < 0)
+  {
+    printf("Invalid log level: use off, summary, access or instruction\n");
+    return;
+  }
+  log_level = level;
+  printf("Log level now %s\n", command);
+}
+
+/*
+  Carry out one command line. Returns 0 if it was quit or exit.
+*/
+int execute_command(char* input)
+{
+  int console_active = 1;
+  StringTokenizer* tokenizer;
+  char* command;
+  int speed;
+  int steps;
+  int n;
+
+  tokenizer = initTokenizer(input);
+  command = nextToken(tokenizer);
+
+  if(strcmp(command, "quit") == 0)
+    console_active = 0;
+  else if(strcmp(command, "exit") == 0)
+    console_active = 0;
+  else if(strcmp(command, "print") == 0 ||
+          strcmp(command, "display") == 0)
+  {
+    command = nextToken(tokenizer);
+    if(strcmp(command, "regs") == 0)
+      display_regs();
+    else if(strcmp(command, "cache") == 0)
+      display_cache();
+    else if(strcmp(command, "levels") == 0)
+      print_hierarchy(&hierarchy, stdout);
+    else if(strcmp(command, "stats") == 0 && bus.count != 0)
+      print_coherence_stats(stdout);
+    else if(strcmp(command, "stats") == 0)
+      print_hierarchy_stats(&hierarchy, stdout);
+    else if(strcmp(command, "sets") == 0)
     {
-      command = nextToken(tokenizer);
-      if(strcmp(command, "i") == 0 || strcmp(command, "index") == 0)
-      {
-	view = INDEX;
-	printf("Cache view now index based\n");
-      }
-      else if(strcmp(command, "a") == 0 || strcmp(command, "assoc") == 0)
-      {
-	view = ASSOC;
-	printf("Cache view now assoc based\n");
-      }
+      if((n = read_level(tokenizer)) >= 0)
+        print_set_stats(&hierarchy.level[n], stdout);
+    }
+    else if(strcmp(command, "log") == 0)
+      dump_log(stdout, atoi(nextToken(tokenizer)));
+    else if(strcmp(command, "curve") == 0)
+    {
+      if(hierarchy.profile == NULL)
+        printf("Not profiling; see the profile command\n");
       else
-	printf("Invalide command: %s\n", input);
+        print_miss_ratio_curve(hierarchy.profile, stdout);
     }
-    else if(strcmp(command, "load") == 0)
+    else
+      printf("Invalid command: %s\n", input);
+  }
+  else if(strcmp(command, "config") == 0)
+    configure_cache(tokenizer);
+  else if(strcmp(command, "level") == 0)
+    configure_level(tokenizer);
+  else if(strcmp(command, "prefetch") == 0)
+    configure_prefetch(tokenizer);
+  else if(strcmp(command, "victim") == 0)
+    configure_victim(tokenizer);
+  else if(strcmp(command, "writebuffer") == 0)
+    configure_write_buffer(tokenizer);
+  else if(strcmp(command, "profile") == 0)
+    configure_profile(tokenizer);
+  else if(strcmp(command, "detail") == 0)
+    configure_detail(tokenizer);
+  else if(strcmp(command, "latency") == 0)
+    configure_latency(tokenizer);
+  else if(strcmp(command, "cores") == 0)
+    configure_cores(tokenizer);
+  else if(strcmp(command, "log") == 0)
+    configure_log(tokenizer);
+  else if(strcmp(command, "trace") == 0)
+  {
+    command = nextToken(tokenizer);
+    if(strlen(command) == 0)
+      printf("Please specify a trace file.\n");
+    else
+      run_trace(&hierarchy, command, stdout);
+  }
+  else if(strcmp(command, "view") == 0)
+  {
+    command = nextToken(tokenizer);
+    if(strcmp(command, "i") == 0 || strcmp(command, "index") == 0)
     {
-      command = nextToken(tokenizer);
-      load_dumpfile(command);
+      view = INDEX;
+      printf("Cache view now index based\n");
     }
-    else if(strcmp(command, "s") == 0)
-      do_step(tokenizer);
-    else if(strcmp(command, "step") == 0)
-      do_step(tokenizer);
-    else if(strcmp(command, "run") == 0)
+    else if(strcmp(command, "a") == 0 || strcmp(command, "assoc") == 0)
     {
-      command = nextToken(tokenizer);
-      speed = atoi(command);
-      if(speed < 10)
-	speed = 10;
-      run_active = 1;
-      while(run_active)
-      {
-	step_processor();
-	usleep(1000 * speed);
-      }
+      view = ASSOC;
+      printf("Cache view now assoc based\n");
     }
-    else if(strcmp(command, "reinit") == 0)
+    else
+      printf("Invalide command: %s\n", input);
+  }
+  else if(strcmp(command, "load") == 0)
+  {
+    command = nextToken(tokenizer);
+    load_dumpfile(command);
+  }
+  else if(strcmp(command, "s") == 0)
+    do_step(tokenizer);
+  else if(strcmp(command, "step") == 0)
+    do_step(tokenizer);
+  else if(strcmp(command, "run") == 0)
+  {
+    command = nextToken(tokenizer);
+    speed = atoi(command);
+    if(speed < 10)
+      speed = 10;
+    run_active = 1;
+    for(steps = 0; run_active; steps++)
+    {
+      if(bus.count != 0)
+        step_cores();
+      else
+        step_processor();
+      usleep(1000 * speed);
+    }
+    if(log_level >= LOG_SUMMARY && bus.count != 0)
+      printf("Ran %d instructions on each of %d cores\n", steps, bus.count);
+    else if(log_level >= LOG_SUMMARY)
+      printf("Ran %d instructions, PC = 0x%08X, %llu cycles so far\n", steps, PC, hierarchy.timing.cycles);
+  }
+  else if(strcmp(command, "reinit") == 0)
+  {
+    reinit_processor();
+    printf("\nPC reset");
+    flush_cache();
+    printf("\nCache flushed\n");
+  }
+  else if(strcmp(command, "reset") == 0)
+  {
+    command = nextToken(tokenizer);
+    if(strcmp(command, "cpu") == 0)
     {
       reinit_processor();
-      printf("\nPC reset");
-      flush_cache();
-      printf("\nCache flushed\n");
+      printf("\nPC reset\n");
     }
-    else if(strcmp(command, "reset") == 0)
+    else if(strcmp(command, "cache") == 0)
     {
-      command = nextToken(tokenizer);
-      if(strcmp(command, "cpu") == 0)
-      {
-	reinit_processor();
-	printf("\nPC reset\n");
-      }
-      else if(strcmp(command, "cache") == 0)
-      {
-	flush_cache();
-	printf("\nCache flushed\n");
-      }
-      else
-	printf("Invalid command: %s\n", input);
+      flush_cache();
+      printf("\nCache flushed\n");
     }
-    else if(strcmp(command, "help") == 0)
-      display_help();
-    else if(strlen(command) != 0)
+    else
       printf("Invalid command: %s\n", input);
+  }
+  else if(strcmp(command, "help") == 0)
+    display_help();
+  else if(strlen(command) != 0)
+    printf("Invalid command: %s\n", input);
+
+  destroy_tokenizer(tokenizer);
+  return console_active;
+}
+
+void activate_no_gui(int argc, char** argv)
+{
+  int console_active = 1;
+  char input[200];
+
+  (void)signal(SIGINT, catch);
+  run_active = 0;
+  log_level = LOG_SUMMARY;
+  
+  printf("Tips v2 Started\n");
 
-    destroy_tokenizer(tokenizer);
+  /* Load file if any */
+  if(argc >= 3)
+    load_dumpfile(argv[argc - 1]);
+
+  while(console_active)
+  {
+    printf("\n[%s] > ", program_name);
+    if(fgets(input, 200, stdin) == NULL)
+      break;
+    console_active = execute_command(input);
   }
 }
+
+/*
+  tips -trace <trace file> [<command file>]: carry out the commands in
+  the command file, such as config and level, then run the trace and
+  exit
+*/
+void activate_trace(int argc, char** argv)
+{
+  char input[200];
+  FILE* commands;
+
+  if(argc < 3)
+  {
+    fprintf(stderr, "Usage: %s -trace <trace file> [<command file>]\n", program_name);
+    exit(1);
+  }
+
+  if(argc >= 4)
+  {
+    if(!(commands = fopen(argv[3], "r")))
+    {
+      fprintf(stderr, "Unable to open [%s]\n", argv[3]);
+      exit(1);
+    }
+    while(fgets(input, 200, commands) != NULL)
+      if(!execute_command(input))
+        break;
+    fclose(commands);
+    printf("\n");
+  }
+
+  exit(run_trace(&hierarchy, argv[2], stdout) == 0 ? 0 : 1);
+}
@@ -0,0 +1,372 @@
+#include "tips.h"
+
+/*
+  Hardware prefetchers. Each level may have one, trained on the demand
+  accesses the level handles (so not on an exclusive level below an L1,
+  which never handles any):
+
+    NEXT_LINE  on a miss, or the first use of a prefetched block, fetch
+               the degree blocks starting distance blocks ahead
+    STRIDE     a table indexed by the PC of the instruction making the
+               access remembers its last address and stride; once the
+               same stride has been seen twice running, fetch degree
+               blocks starting distance strides ahead. Traces carry no
+               PCs, so it is off while the hierarchy only tracks tags
+    STREAM     distance stream buffers of degree blocks each, held
+               beside the cache. A miss that finds its block in a buffer
+               takes it from there, dropping the blocks ahead of it, and
+               the buffer is topped up; any other miss restarts the least
+               recently used buffer just after the missing block.
+
+  Prefetches are queued and only issued once the access that caused them
+  has finished at every level, so they can't disturb it.
+
+  A prefetched block is useful if it is used before it leaves the cache
+  (or buffer), and useless if not. Its lead is the number of accesses to
+  the level between the prefetch and that first use.
+*/
+
+#define STRIDE_TABLE_SIZE 256
+
+typedef struct {
+  address pc;
+  address last;
+  int stride;
+  int confidence;                /* 0..3; prefetch from 2 */
+} strideEntry;
+
+typedef struct {
+  address addr;
+  int ready;                     /* the data has been fetched */
+  unsigned long long time;       /* level accesses when it was */
+  byte data[MAX_BLOCK_SIZE];
+} streamEntry;
+
+typedef struct {
+  streamEntry entry[MAX_PREFETCH_DEGREE];
+  unsigned int count;
+  address next;                  /* block to add next */
+  unsigned long long used;       /* level accesses at its last use */
+} streamBuffer;
+
+struct prefetcher {
+  strideEntry table[STRIDE_TABLE_SIZE];
+  streamBuffer stream[MAX_STREAMS];
+};
+
+static char* prefetch_names[] = { "none", "next", "stride", "stream" };
+
+/* Accesses to a level so far, which times its prefetches */
+static unsigned long long now(cacheLevel* level)
+{
+  return level->stats.reads + level->stats.writes;
+}
+
+/* The prefetch kind called name, or -1 */
+int parse_prefetch_kind(const char* name)
+{
+  int i;
+
+  for(i = 0; i <= STREAM_PREFETCH; i++)
+    if(strcmp(name, prefetch_names[i]) == 0)
+      return i;
+  return -1;
+}
+
+/* Write a description of level's prefetcher into buffer */
+void describe_prefetcher(cacheLevel* level, char* buffer)
+{
+  switch(level->prefetch)
+  {
+  case NO_PREFETCH:
+    buffer[0] = '\0';
+    break;
+  case STREAM_PREFETCH:
+    sprintf(buffer, "%u stream buffers of %u blocks", level->prefetch_distance, level->prefetch_degree);
+    break;
+  default:
+    sprintf(buffer, "%s prefetch, degree %u, distance %u", level->prefetch == NEXT_LINE_PREFETCH ? "next-line" : "stride",
+            level->prefetch_degree, level->prefetch_distance);
+  }
+}
+
+/* Nonzero if a level of h prefetches by stride, which trace runs can't */
+int stride_prefetching(cacheHierarchy* h)
+{
+  int l;
+
+  for(l = 0; l < LEVEL_COUNT; l++)
+    if(h->level[l].prefetch == STRIDE_PREFETCH)
+      return 1;
+  return 0;
+}
+
+/* Set up the state for level's prefetcher, freeing any old state */
+void allocate_prefetcher(cacheLevel* level)
+{
+  free_prefetcher(level);
+  if(level->prefetch == NO_PREFETCH)
+    return;
+  level->prefetcher = calloc(1, sizeof(prefetcher));
+  if(level->prefetcher == NULL)
+  {
+    fprintf(stderr, "Unable to allocate the %s prefetcher\n", level->name);
+    exit(1);
+  }
+}
+
+void free_prefetcher(cacheLevel* level)
+{
+  free(level->prefetcher);
+  level->prefetcher = NULL;
+}
+
+/* Forget everything the prefetcher has learned or fetched */
+void flush_prefetcher(cacheLevel* level)
+{
+  if(level->prefetcher != NULL)
+    memset(level->prefetcher, 0, sizeof(prefetcher));
+  level->hierarchy->pending_count = 0;
+}
+
+static void queue_prefetch(cacheLevel* level, address addr)
+{
+  cacheHierarchy* h = level->hierarchy;
+
+  if(h->pending_count == PREFETCH_QUEUE_SIZE)
+    return;
+  h->pending[h->pending_count].level = level;
+  h->pending[h->pending_count].addr = addr & ~(level->block_size - 1);
+  h->pending_count++;
+}
+
+/* Add the stream's next block to its end, to be fetched */
+static void extend_stream(cacheLevel* level, streamBuffer* s)
+{
+  streamEntry* e = &s->entry[s->count++];
+
+  e->addr = s->next;
+  e->ready = 0;
+  s->next += level->block_size;
+  queue_prefetch(level, e->addr);
+}
+
+/* Drop the first n entries of a stream buffer */
+static void drop_entries(cacheLevel* level, streamBuffer* s, unsigned int n)
+{
+  unsigned int i;
+
+  for(i = 0; i < n; i++)
+    if(s->entry[i].ready)
+      level->stats.useless_prefetches++;
+  s->count -= n;
+  memmove(s->entry, s->entry + n, sizeof(streamEntry) * s->count);
+}
+
+/*
+  If a stream buffer holds the block at addr, copy it into data, take it
+  out of the buffer and return nonzero
+*/
+int take_streamed(cacheLevel* level, address addr, byte* data)
+{
+  streamBuffer* s;
+  unsigned int b;
+  unsigned int i;
+
+  if(level->prefetch != STREAM_PREFETCH)
+    return 0;
+  for(b = 0; b < level->prefetch_distance; b++)
+  {
+    s = &level->prefetcher->stream[b];
+    for(i = 0; i < s->count; i++)
+      if(s->entry[i].addr == addr && s->entry[i].ready)
+      {
+        memcpy(data, s->entry[i].data, level->block_size);
+        level->stats.useful_prefetches++;
+        level->stats.prefetch_lead += now(level) - s->entry[i].time;
+        s->entry[i].ready = 0;
+        drop_entries(level, s, i + 1);
+        drop_streamed(level, addr);
+        s->used = now(level);
+        while(s->count < level->prefetch_degree)
+          extend_stream(level, s);
+        return 1;
+      }
+  }
+  return 0;
+}
+
+/* Forget any copy of the block at addr in a stream buffer, as it is being changed or taken */
+void drop_streamed(cacheLevel* level, address addr)
+{
+  streamBuffer* s;
+  unsigned int b;
+  unsigned int i;
+
+  if(level->prefetch != STREAM_PREFETCH)
+    return;
+  addr &= ~(level->block_size - 1);
+  for(b = 0; b < level->prefetch_distance; b++)
+  {
+    s = &level->prefetcher->stream[b];
+    for(i = 0; i < s->count; i++)
+      if(s->entry[i].addr == addr && s->entry[i].ready)
+      {
+        s->entry[i].ready = 0;
+        level->stats.useless_prefetches++;
+      }
+  }
+}
+
+static void start_stream(cacheLevel* level, address addr)
+{
+  streamBuffer* s = &level->prefetcher->stream[0];
+  unsigned int b;
+
+  for(b = 1; b < level->prefetch_distance; b++)
+    if(level->prefetcher->stream[b].used < s->used)
+      s = &level->prefetcher->stream[b];
+  drop_entries(level, s, s->count);
+  s->next = (addr & ~(level->block_size - 1)) + level->block_size;
+  s->used = now(level);
+  while(s->count < level->prefetch_degree)
+    extend_stream(level, s);
+}
+
+static void train_stride(cacheLevel* level, address addr)
+{
+  strideEntry* e = &level->prefetcher->table[(level->hierarchy->pc >> 2) & (STRIDE_TABLE_SIZE - 1)];
+  address block = addr & ~(level->block_size - 1);
+  address target;
+  address last = block;
+  unsigned int k;
+  int delta;
+
+  if(e->pc != level->hierarchy->pc)
+  {
+    e->pc = level->hierarchy->pc;
+    e->last = addr;
+    e->stride = 0;
+    e->confidence = 0;
+    return;
+  }
+
+  delta = addr - e->last;
+  if(delta == 0)
+    return;
+  if(delta == e->stride)
+    e->confidence += e->confidence < 3;
+  else if(e->confidence > 0)
+    e->confidence--;
+  else
+    e->stride = delta;
+  e->last = addr;
+
+  if(e->confidence < 2)
+    return;
+  for(k = 0; k < level->prefetch_degree; k++)
+  {
+    target = (addr + e->stride * (int)(level->prefetch_distance + k)) & ~(level->block_size - 1);
+    if(target != last)
+      queue_prefetch(level, target);
+    last = target;
+  }
+}
+
+/*
+  Train level's prefetcher on a demand access to addr. missed is
+  nonzero if the access missed, hit is nonzero if it was the first use of
+  a prefetched block.
+*/
+void prefetch_access(cacheLevel* level, address addr, int missed, int hit)
+{
+  address block = addr & ~(level->block_size - 1);
+  unsigned int k;
+
+  switch(level->prefetch)
+  {
+  case NEXT_LINE_PREFETCH:
+    if(missed || hit)
+      for(k = 0; k < level->prefetch_degree; k++)
+        queue_prefetch(level, block + (level->prefetch_distance + k) * level->block_size);
+    break;
+  case STRIDE_PREFETCH:
+    if(!level->hierarchy->tags_only)
+      train_stride(level, addr);
+    break;
+  case STREAM_PREFETCH:
+    if(missed)
+      start_stream(level, addr);
+    break;
+  default:
+    break;
+  }
+}
+
+/* Fetch the stream buffer entries waiting for the block at addr */
+static void fill_streams(cacheLevel* level, address addr)
+{
+  streamBuffer* s;
+  unsigned int b;
+  unsigned int i;
+
+  for(b = 0; b < level->prefetch_distance; b++)
+  {
+    s = &level->prefetcher->stream[b];
+    for(i = 0; i < s->count; i++)
+      if(s->entry[i].addr == addr && !s->entry[i].ready)
+      {
+        /* Never keep a block both here and in the cache */
+        if(level_holds(level, addr))
+          return;
+        copy_from_below(level, addr, s->entry[i].data);
+        s->entry[i].ready = 1;
+        s->entry[i].time = now(level);
+        level->stats.prefetches++;
+        return;
+      }
+  }
+}
+
+/* Issue the prefetches queued while accessing h, and any they cause */
+void issue_prefetches(cacheHierarchy* h)
+{
+  prefetchRequest r;
+  int i;
+
+  for(i = 0; i < h->pending_count; i++)
+  {
+    r = h->pending[i];
+    if(r.level->prefetch == STREAM_PREFETCH)
+      fill_streams(r.level, r.addr);
+    else
+      prefetch_block(r.level, r.addr);
+  }
+  h->pending_count = 0;
+}
+
+/* Write the prefetch statistics of every level that prefetches */
+void print_prefetch_stats(cacheHierarchy* h, FILE* out)
+{
+  cacheLevel* level;
+  cacheStats* s;
+  int header = 0;
+  int i;
+
+  for(i = 0; i < LEVEL_COUNT; i++)
+  {
+    level = &h->level[i];
+    if(level->prefetcher == NULL || level->set_count == 0)
+      continue;
+    if(!header)
+      fprintf(out, "Prefetch     Issued     Useful    Useless  Accuracy  Coverage   Lead\n");
+    header = 1;
+    s = &level->stats;
+    fprintf(out, "%-5s    %10llu %10llu %10llu  %8.4f  %8.4f  %5.1f\n", level->name,
+            s->prefetches, s->useful_prefetches, s->useless_prefetches,
+            s->prefetches ? (double)s->useful_prefetches / s->prefetches : 0.0,
+            s->useful_prefetches ? (double)s->useful_prefetches /
+            (s->useful_prefetches + s->read_misses + s->write_misses) : 0.0,
+            s->useful_prefetches ? (double)s->prefetch_lead / s->useful_prefetches : 0.0);
+  }
+}
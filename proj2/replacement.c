@@ -0,0 +1,179 @@
+#include "tips.h"
+#include "util.h"
+
+/*
+  Replacement policies. Each is a table of hooks the hierarchy calls with
+  the set and the way (index in the set) of a block: on_hit when a valid
+  block is used again, on_fill when a block has just been placed, and
+  victim to pick the way to replace in a full set. Invalid blocks are
+  always filled first, so victim only sees valid ones.
+
+  Per-block state lives in lru.value and accessCount, per-set state in
+  the set's state word:
+
+    LRU    lru.value is the level's clock at the block's last use
+    LFU    accessCount counts uses since the fill; ties go to the LRU
+    PLRU   the set's state holds a binary tree of assoc - 1 bits, node n
+           at bit n (the root is 1, its children 2n and 2n + 1); each
+           points to the half that was used less recently
+    NRU    lru.value is a referenced bit; when the last one would be
+           set, the others are cleared
+*/
+
+static void lru_touch(cacheLevel* level, cacheSet* set, unsigned int way)
+{
+  set->block[way].lru.value = ++level->clock;
+}
+
+static unsigned int lru_victim(cacheLevel* level, cacheSet* set)
+{
+  unsigned int victim = 0;
+  unsigned int i;
+
+  for(i = 1; i < level->assoc; i++)
+    if(set->block[i].lru.value < set->block[victim].lru.value)
+      victim = i;
+  return victim;
+}
+
+static void lfu_hit(cacheLevel* level, cacheSet* set, unsigned int way)
+{
+  set->block[way].lru.value = ++level->clock;
+  set->block[way].accessCount++;
+}
+
+static void lfu_fill(cacheLevel* level, cacheSet* set, unsigned int way)
+{
+  set->block[way].lru.value = ++level->clock;
+  set->block[way].accessCount = 1;
+}
+
+static unsigned int lfu_victim(cacheLevel* level, cacheSet* set)
+{
+  cacheBlock* b = set->block;
+  unsigned int victim = 0;
+  unsigned int i;
+
+  for(i = 1; i < level->assoc; i++)
+    if(b[i].accessCount < b[victim].accessCount ||
+       (b[i].accessCount == b[victim].accessCount && b[i].lru.value < b[victim].lru.value))
+      victim = i;
+  return victim;
+}
+
+/* Ways below the next power of two up from assoc, for a tree over any associativity */
+static unsigned int tree_ways(unsigned int assoc)
+{
+  unsigned int ways = 1;
+
+  while(ways < assoc)
+    ways *= 2;
+  return ways;
+}
+
+static void plru_touch(cacheLevel* level, cacheSet* set, unsigned int way)
+{
+  unsigned int low = 0;
+  unsigned int high = tree_ways(level->assoc);
+  unsigned int node = 1;
+  unsigned int middle;
+
+  /* Point every node on the way to the block at the other half */
+  while(high - low > 1)
+  {
+    middle = (low + high) / 2;
+    if(way < middle)
+    {
+      set->state |= 1u << node;
+      high = middle;
+      node = 2 * node;
+    }
+    else
+    {
+      set->state &= ~(1u << node);
+      low = middle;
+      node = 2 * node + 1;
+    }
+  }
+}
+
+static unsigned int plru_victim(cacheLevel* level, cacheSet* set)
+{
+  unsigned int low = 0;
+  unsigned int high = tree_ways(level->assoc);
+  unsigned int node = 1;
+  unsigned int middle;
+
+  /* Follow the pointers, never into a half with no ways */
+  while(high - low > 1)
+  {
+    middle = (low + high) / 2;
+    if((set->state & 1u << node) && middle < level->assoc)
+    {
+      low = middle;
+      node = 2 * node + 1;
+    }
+    else
+    {
+      high = middle;
+      node = 2 * node;
+    }
+  }
+  return low;
+}
+
+static void nru_touch(cacheLevel* level, cacheSet* set, unsigned int way)
+{
+  unsigned int i;
+
+  set->block[way].lru.value = 1;
+  for(i = 0; i < level->assoc && set->block[i].lru.value; i++)
+    ;
+  if(i == level->assoc)
+    for(i = 0; i < level->assoc; i++)
+      set->block[i].lru.value = i == way;
+}
+
+static unsigned int nru_victim(cacheLevel* level, cacheSet* set)
+{
+  unsigned int i;
+
+  for(i = 0; i < level->assoc; i++)
+    if(!set->block[i].lru.value)
+      return i;
+  return 0;
+}
+
+static void random_touch(cacheLevel* level, cacheSet* set, unsigned int way)
+{
+}
+
+static unsigned int random_victim(cacheLevel* level, cacheSet* set)
+{
+  return randomint_r(&level->seed, level->assoc);
+}
+
+/* Indexed by ReplacementPolicy */
+const replacementPolicy replacement_policies[POLICY_COUNT] = {
+  { "r",    "Random", random_touch, random_touch, random_victim },
+  { "lru",  "LRU",    lru_touch,    lru_touch,    lru_victim    },
+  { "lfu",  "LFU",    lfu_hit,      lfu_fill,     lfu_victim    },
+  { "plru", "PLRU",   plru_touch,   plru_touch,   plru_victim   },
+  { "nru",  "NRU",    nru_touch,    nru_touch,    nru_victim    },
+};
+
+/* The policy named key as the config command takes it, or -1 */
+int parse_replacement_policy(const char* key)
+{
+  int p;
+
+  for(p = 0; p < POLICY_COUNT; p++)
+    if(strcmp(key, replacement_policies[p].key) == 0)
+      return p;
+  return -1;
+}
+
+char* policy_name(ReplacementPolicy p)
+{
+  return replacement_policies[p].name;
+}
@@ -0,0 +1,341 @@
+#include "tips.h"
+#include "util.h"
+
+/*
+  Single-pass LRU miss-ratio curves (Mattson's stack algorithm). The
+  stack distance of an access is the number of distinct blocks used
+  since the last access to its block; it misses in an LRU cache of C
+  blocks exactly when that distance is C or more.
+
+  Fully associative distances are counted as in Bennett and Kruskal:
+  each block is marked at the time of its latest access in a Fenwick
+  tree, so the distance is the number of marks after the block's
+  previous time, found in O(log n). When the tree fills up, the live
+  times are renumbered from 1.
+
+  For set-associative caches, each power-of-two set count keeps an LRU
+  stack per set of the last MAX_ASSOC blocks used in it. The depth a
+  block is found at gives its distance within its set for every
+  associativity at once.
+*/
+
+#define EMPTY 0xffffffff                 /* no block; block numbers are < 2^30 */
+#define SET_COUNTS 15                    /* 1, 2, 4, ... MAX_SETS sets */
+
+struct stackDistance {
+  unsigned int block_size;
+  unsigned int offset_bits;
+  unsigned long long accesses;
+  unsigned long long cold;               /* first accesses to a block */
+
+  /* Fully associative: block -> time of latest access */
+  unsigned int* keys;
+  unsigned int* times;
+  unsigned int hash_size;                /* power of two */
+  unsigned int blocks;                   /* distinct blocks seen */
+  int* tree;                             /* Fenwick tree over times 1..capacity */
+  unsigned int* owner;                   /* block last accessed at each time */
+  unsigned int capacity;
+  unsigned int now;
+  unsigned long long* histogram;         /* accesses at each distance */
+  unsigned int histogram_size;
+
+  /* Set associative: LRU stacks, and accesses at each depth (MAX_ASSOC = not found) */
+  unsigned int* stacks[SET_COUNTS];
+  unsigned long long depth[SET_COUNTS][MAX_ASSOC + 1];
+};
+
+static void* allocate(size_t size)
+{
+  void* p = calloc(1, size);
+
+  if(p == NULL)
+  {
+    fprintf(stderr, "Unable to allocate memory for stack distances\n");
+    exit(1);
+  }
+  return p;
+}
+
+stackDistance* new_stack_distance(unsigned int block_size)
+{
+  stackDistance* sd = allocate(sizeof(stackDistance));
+  int k;
+
+  sd->block_size = block_size;
+  sd->offset_bits = uint_log2(block_size);
+  sd->hash_size = 1024;
+  sd->keys = allocate(sizeof(unsigned int) * sd->hash_size);
+  sd->times = allocate(sizeof(unsigned int) * sd->hash_size);
+  memset(sd->keys, 0xff, sizeof(unsigned int) * sd->hash_size);
+  sd->capacity = 1024;
+  sd->tree = allocate(sizeof(int) * (sd->capacity + 1));
+  sd->owner = allocate(sizeof(unsigned int) * (sd->capacity + 1));
+  sd->histogram_size = 1024;
+  sd->histogram = allocate(sizeof(unsigned long long) * sd->histogram_size);
+
+  for(k = 0; k < SET_COUNTS; k++)
+  {
+    sd->stacks[k] = allocate(sizeof(unsigned int) * ((size_t)MAX_ASSOC << k));
+    memset(sd->stacks[k], 0xff, sizeof(unsigned int) * ((size_t)MAX_ASSOC << k));
+  }
+  return sd;
+}
+
+void free_stack_distance(stackDistance* sd)
+{
+  int k;
+
+  if(sd == NULL)
+    return;
+  for(k = 0; k < SET_COUNTS; k++)
+    free(sd->stacks[k]);
+  free(sd->keys);
+  free(sd->times);
+  free(sd->tree);
+  free(sd->owner);
+  free(sd->histogram);
+  free(sd);
+}
+
+/* Slot for block in the hash table: its own, or the empty one it would go in */
+static unsigned int slot_of(stackDistance* sd, unsigned int block)
+{
+  unsigned int i = (block * 2654435761u) & (sd->hash_size - 1);
+
+  while(sd->keys[i] != block && sd->keys[i] != EMPTY)
+    i = (i + 1) & (sd->hash_size - 1);
+  return i;
+}
+
+static void grow_hash(stackDistance* sd)
+{
+  unsigned int* keys = sd->keys;
+  unsigned int* times = sd->times;
+  unsigned int size = sd->hash_size;
+  unsigned int i;
+  unsigned int slot;
+
+  sd->hash_size *= 2;
+  sd->keys = allocate(sizeof(unsigned int) * sd->hash_size);
+  sd->times = allocate(sizeof(unsigned int) * sd->hash_size);
+  memset(sd->keys, 0xff, sizeof(unsigned int) * sd->hash_size);
+  for(i = 0; i < size; i++)
+    if(keys[i] != EMPTY)
+    {
+      slot = slot_of(sd, keys[i]);
+      sd->keys[slot] = keys[i];
+      sd->times[slot] = times[i];
+    }
+  free(keys);
+  free(times);
+}
+
+static void tree_add(stackDistance* sd, unsigned int t, int n)
+{
+  for(; t <= sd->capacity; t += t & -t)
+    sd->tree[t] += n;
+}
+
+/* Number of marks at times 1..t */
+static unsigned int tree_sum(stackDistance* sd, unsigned int t)
+{
+  unsigned int sum = 0;
+
+  for(; t > 0; t -= t & -t)
+    sum += sd->tree[t];
+  return sum;
+}
+
+/*
+  Renumber the live times 1..blocks in order, making the tree at least
+  twice as big as that, and rebuild it
+*/
+static void compact(stackDistance* sd)
+{
+  unsigned int* owner = sd->owner;
+  unsigned int t;
+  unsigned int n = 0;
+
+  for(t = 1; t <= sd->now; t++)
+    if(owner[t] != EMPTY)
+    {
+      owner[++n] = owner[t];
+      sd->times[slot_of(sd, owner[n])] = n;
+    }
+
+  if(sd->capacity < 2 * n)
+  {
+    sd->capacity *= 2;
+    free(sd->tree);
+    sd->tree = allocate(sizeof(int) * (sd->capacity + 1));
+    sd->owner = allocate(sizeof(unsigned int) * (sd->capacity + 1));
+    memcpy(sd->owner + 1, owner + 1, sizeof(unsigned int) * n);
+    free(owner);
+  }
+  else
+    memset(sd->tree, 0, sizeof(int) * (sd->capacity + 1));
+
+  /* Build the tree in place in O(capacity) */
+  for(t = 1; t <= sd->capacity; t++)
+  {
+    sd->owner[t] = t <= n ? sd->owner[t] : EMPTY;
+    sd->tree[t] += t <= n;
+    if(t + (t & -t) <= sd->capacity)
+      sd->tree[t + (t & -t)] += sd->tree[t];
+  }
+  sd->now = n;
+}
+
+static void count_distance(stackDistance* sd, unsigned int distance)
+{
+  while(distance >= sd->histogram_size)
+  {
+    sd->histogram = realloc(sd->histogram, sizeof(unsigned long long) * sd->histogram_size * 2);
+    if(sd->histogram == NULL)
+    {
+      fprintf(stderr, "Unable to allocate memory for stack distances\n");
+      exit(1);
+    }
+    memset(sd->histogram + sd->histogram_size, 0, sizeof(unsigned long long) * sd->histogram_size);
+    sd->histogram_size *= 2;
+  }
+  sd->histogram[distance]++;
+}
+
+/* Move block to the top of its LRU stack of MAX_ASSOC, returning its old depth */
+static unsigned int stack_access(unsigned int* stack, unsigned int block)
+{
+  unsigned int d;
+
+  for(d = 0; d < MAX_ASSOC && stack[d] != block; d++)
+    if(stack[d] == EMPTY)
+      break;
+  if(d == MAX_ASSOC || stack[d] != block)
+  {
+    memmove(stack + 1, stack, sizeof(unsigned int) * (MAX_ASSOC - 1));
+    stack[0] = block;
+    return MAX_ASSOC;
+  }
+  memmove(stack + 1, stack, sizeof(unsigned int) * d);
+  stack[0] = block;
+  return d;
+}
+
+void stack_distance_access(stackDistance* sd, address addr)
+{
+  unsigned int block = addr >> sd->offset_bits;
+  unsigned int slot = slot_of(sd, block);
+  int k;
+
+  sd->accesses++;
+  if(sd->keys[slot] == EMPTY)
+  {
+    sd->cold++;
+    sd->keys[slot] = block;
+    if(++sd->blocks > sd->hash_size / 2)
+    {
+      grow_hash(sd);
+      slot = slot_of(sd, block);
+    }
+  }
+  else
+  {
+    count_distance(sd, tree_sum(sd, sd->now) - tree_sum(sd, sd->times[slot]));
+    tree_add(sd, sd->times[slot], -1);
+    sd->owner[sd->times[slot]] = EMPTY;
+  }
+
+  if(sd->now == sd->capacity)
+  {
+    compact(sd);
+    slot = slot_of(sd, block);
+  }
+  sd->times[slot] = ++sd->now;
+  sd->owner[sd->now] = block;
+  tree_add(sd, sd->now, 1);
+
+  for(k = 0; k < SET_COUNTS; k++)
+    sd->depth[k][stack_access(sd->stacks[k] + ((block & ((1 << k) - 1)) * MAX_ASSOC), block)]++;
+}
+
+/*
+  Misses an LRU cache with this many sets and ways of sd->block_size
+  byte blocks would have taken; set_count 0 means fully associative.
+  Returns -1 for a geometry that wasn't tracked.
+*/
+long long stack_distance_misses(stackDistance* sd, unsigned int set_count, unsigned int assoc)
+{
+  unsigned long long misses = sd->cold;
+  unsigned int d;
+  unsigned int k;
+
+  if(set_count == 0)
+  {
+    for(d = assoc; d < sd->histogram_size; d++)
+      misses += sd->histogram[d];
+    return misses;
+  }
+
+  k = uint_log2(set_count);
+  if(set_count != 1u << k || k >= SET_COUNTS || assoc > MAX_ASSOC)
+    return -1;
+  misses = 0;
+  for(d = assoc; d <= MAX_ASSOC; d++)
+    misses += sd->depth[k][d];
+  return misses;
+}
+
+static double ratio(unsigned long long part, unsigned long long whole)
+{
+  return whole ? (double)part / whole : 0.0;
+}
+
+void print_miss_ratio_curve(stackDistance* sd, FILE* out)
+{
+  unsigned long long capacity;
+  unsigned int a;
+  int k;
+
+  fprintf(out, "LRU miss ratios for %u byte blocks: %llu accesses, %llu compulsory misses, %u distinct blocks\n",
+          sd->block_size, sd->accesses, sd->cold, sd->blocks);
+
+  fprintf(out, "\nFully associative\n      Size    Blocks      Misses  Miss-Rate\n");
+  for(capacity = 1; ; capacity *= 2)
+  {
+    fprintf(out, "%10llu %9llu %11lld  %9.6f\n", capacity * sd->block_size, capacity,
+            stack_distance_misses(sd, 0, capacity), ratio(stack_distance_misses(sd, 0, capacity), sd->accesses));
+    if(capacity >= sd->blocks)
+      break;
+  }
+
+  fprintf(out, "\nSet associative (rows are set counts, columns ways)\n  Sets");
+  for(a = 1; a <= MAX_ASSOC; a *= 2)
+    fprintf(out, " %9u", a);
+  fprintf(out, "\n");
+  for(k = 0; k < SET_COUNTS; k++)
+  {
+    fprintf(out, "%6u", 1 << k);
+    for(a = 1; a <= MAX_ASSOC; a *= 2)
+      fprintf(out, " %9.6f", ratio(stack_distance_misses(sd, 1 << k, a), sd->accesses));
+    fprintf(out, "\n");
+  }
+}
+
+/*
+  Profile the accesses of the given kinds (a mask of 1 << AccessKind) to
+  h in blocks of block_size bytes from now on, or stop if block_size is 0
+*/
+void profile_hierarchy(cacheHierarchy* h, unsigned int block_size, int kinds)
+{
+  free_stack_distance(h->profile);
+  h->profile = block_size ? new_stack_distance(block_size) : NULL;
+  h->profile_kinds = kinds;
+}
+
+/* Start the profile of h, if any, over again */
+void restart_profile(cacheHierarchy* h)
+{
+  if(h->profile != NULL)
+    profile_hierarchy(h, h->profile->block_size, h->profile_kinds);
+}
@@ -0,0 +1,326 @@
+#include "tips.h"
+#include "util.h"
+
+/*
+  Detailed statistics, kept while the hierarchy's detailed flag is set:
+  hits, misses, evictions and write backs per set of each level and per
+  type of processor access, DRAM bytes per type, and the three Cs of
+  every miss. Everything is counted under the type of the processor
+  access that caused it, so an L2 write back caused by a load counts as
+  a read.
+
+  A miss is compulsory if it is the first access to its block at the
+  level since the flush, found in a bitmap of the blocks touched that is
+  allocated in chunks as they are needed. Otherwise it is a capacity miss
+  if a fully associative LRU cache of as many blocks would have missed
+  too, and a conflict miss if it would have hit. That shadow cache is a
+  hash table of its blocks and a list of them in LRU order, so it costs
+  O(1) an access.
+*/
+
+#define CHUNK_BITS 16                    /* blocks per bitmap chunk, as a power of two */
+#define NIL 0xffffffff
+
+typedef struct {
+  unsigned int block;
+  unsigned int prev;                     /* more recently used */
+  unsigned int next;                     /* less recently used */
+} shadowEntry;
+
+struct missClassifier {
+  unsigned int** touched;                /* bitmap chunks, NULL until one is needed */
+  unsigned int chunk_count;
+  shadowEntry* entry;
+  unsigned int capacity;                 /* blocks in the shadow cache */
+  unsigned int used;
+  unsigned int head;                     /* most recently used, or NIL */
+  unsigned int tail;                     /* least recently used, or NIL */
+  unsigned int* hash;                    /* entry of each block, or NIL */
+  unsigned int hash_bits;                /* at least twice capacity */
+};
+
+static char* type_names[ACCESS_TYPES] = { "read", "write", "fetch" };
+
+static void* allocate(size_t size)
+{
+  void* p = calloc(1, size);
+
+  if(p == NULL)
+  {
+    fprintf(stderr, "Unable to allocate memory for detailed statistics\n");
+    exit(1);
+  }
+  return p;
+}
+
+/* Set up the counters and classifier of level, freeing the old ones, if its hierarchy is detailed */
+void allocate_detail(cacheLevel* level)
+{
+  missClassifier* c;
+
+  free_detail(level);
+  if(!level->hierarchy->detailed || level->set_count == 0 || level->assoc == 0 || level->block_size == 0)
+    return;
+
+  level->set_stats = allocate(sizeof(detailStats) * level->set_count);
+  c = level->classifier = allocate(sizeof(missClassifier));
+  c->chunk_count = 1u << (32 - level->offset_bits - CHUNK_BITS);
+  c->touched = allocate(sizeof(unsigned int*) * c->chunk_count);
+  c->capacity = level->set_count * level->assoc;
+  c->entry = allocate(sizeof(shadowEntry) * c->capacity);
+  c->hash_bits = uint_log2(c->capacity) + 2;
+  c->hash = allocate(sizeof(unsigned int) << c->hash_bits);
+  clear_classifier(level);
+}
+
+void free_detail(cacheLevel* level)
+{
+  missClassifier* c = level->classifier;
+  unsigned int i;
+
+  free(level->set_stats);
+  level->set_stats = NULL;
+  if(c == NULL)
+    return;
+  for(i = 0; i < c->chunk_count; i++)
+    free(c->touched[i]);
+  free(c->touched);
+  free(c->entry);
+  free(c->hash);
+  free(c);
+  level->classifier = NULL;
+}
+
+/* Forget every block touched, so the next access to each is compulsory */
+void clear_classifier(cacheLevel* level)
+{
+  missClassifier* c = level->classifier;
+  unsigned int i;
+
+  if(c == NULL)
+    return;
+  for(i = 0; i < c->chunk_count; i++)
+  {
+    free(c->touched[i]);
+    c->touched[i] = NULL;
+  }
+  memset(c->hash, 0xff, sizeof(unsigned int) << c->hash_bits);
+  c->used = 0;
+  c->head = c->tail = NIL;
+}
+
+/* Mark block touched, returning nonzero if it wasn't */
+static int first_touch(missClassifier* c, unsigned int block)
+{
+  unsigned int** chunk = &c->touched[block >> CHUNK_BITS];
+  unsigned int bit = block & ((1u << CHUNK_BITS) - 1);
+
+  if(*chunk == NULL)
+    *chunk = allocate(sizeof(unsigned int) << (CHUNK_BITS - 5));
+  if((*chunk)[bit >> 5] & 1u << (bit & 31))
+    return 0;
+  (*chunk)[bit >> 5] |= 1u << (bit & 31);
+  return 1;
+}
+
+static unsigned int home_of(missClassifier* c, unsigned int block)
+{
+  return (block * 2654435761u) >> (32 - c->hash_bits);
+}
+
+/* The hash slot holding block, or the empty one it would go in */
+static unsigned int slot_of(missClassifier* c, unsigned int block)
+{
+  unsigned int mask = (1u << c->hash_bits) - 1;
+  unsigned int i = home_of(c, block);
+
+  while(c->hash[i] != NIL && c->entry[c->hash[i]].block != block)
+    i = (i + 1) & mask;
+  return i;
+}
+
+/* Empty a hash slot, moving back any later entry that probed past it */
+static void remove_slot(missClassifier* c, unsigned int slot)
+{
+  unsigned int mask = (1u << c->hash_bits) - 1;
+  unsigned int i = slot;
+  unsigned int home;
+
+  c->hash[slot] = NIL;
+  for(i = (i + 1) & mask; c->hash[i] != NIL; i = (i + 1) & mask)
+  {
+    home = home_of(c, c->entry[c->hash[i]].block);
+    if(((i - home) & mask) >= ((i - slot) & mask))
+    {
+      c->hash[slot] = c->hash[i];
+      c->hash[i] = NIL;
+      slot = i;
+    }
+  }
+}
+
+static void unlink_entry(missClassifier* c, unsigned int e)
+{
+  if(c->entry[e].prev != NIL)
+    c->entry[c->entry[e].prev].next = c->entry[e].next;
+  else
+    c->head = c->entry[e].next;
+  if(c->entry[e].next != NIL)
+    c->entry[c->entry[e].next].prev = c->entry[e].prev;
+  else
+    c->tail = c->entry[e].prev;
+}
+
+static void push_entry(missClassifier* c, unsigned int e)
+{
+  c->entry[e].prev = NIL;
+  c->entry[e].next = c->head;
+  if(c->head != NIL)
+    c->entry[c->head].prev = e;
+  else
+    c->tail = e;
+  c->head = e;
+}
+
+/* Access block in the shadow cache, returning nonzero if it hit */
+static int shadow_access(missClassifier* c, unsigned int block)
+{
+  unsigned int slot = slot_of(c, block);
+  unsigned int e;
+
+  if(c->hash[slot] != NIL)
+  {
+    e = c->hash[slot];
+    unlink_entry(c, e);
+    push_entry(c, e);
+    return 1;
+  }
+
+  if(c->used < c->capacity)
+    e = c->used++;
+  else
+  {
+    e = c->tail;
+    unlink_entry(c, e);
+    remove_slot(c, slot_of(c, c->entry[e].block));
+    slot = slot_of(c, block);
+  }
+  c->entry[e].block = block;
+  c->hash[slot] = e;
+  push_entry(c, e);
+  return 0;
+}
+
+static detailStats* set_of(cacheLevel* level, address addr)
+{
+  return &level->set_stats[(addr >> level->offset_bits) & (level->set_count - 1)];
+}
+
+/* Count an access to addr at level, and classify it if it missed */
+void count_access(cacheLevel* level, address addr, int missed)
+{
+  detailStats* set;
+  detailStats* type;
+  unsigned int block = addr >> level->offset_bits;
+  int first;
+  int shadow_hit;
+  MissClass class;
+
+  if(level->classifier == NULL)
+    return;
+  set = set_of(level, addr);
+  type = &level->type_stats[level->hierarchy->type];
+
+  /* Both run on every access, to see the whole stream */
+  first = first_touch(level->classifier, block);
+  shadow_hit = shadow_access(level->classifier, block);
+  if(!missed)
+  {
+    set->hits++;
+    type->hits++;
+    return;
+  }
+
+  class = first ? COMPULSORY : (shadow_hit ? CONFLICT : CAPACITY);
+  set->misses++;
+  type->misses++;
+  set->miss_class[class]++;
+  type->miss_class[class]++;
+}
+
+void count_eviction(cacheLevel* level, address addr)
+{
+  if(level->classifier == NULL)
+    return;
+  set_of(level, addr)->evictions++;
+  level->type_stats[level->hierarchy->type].evictions++;
+}
+
+void count_writeback(cacheLevel* level, address addr)
+{
+  if(level->classifier == NULL)
+    return;
+  set_of(level, addr)->writebacks++;
+  level->type_stats[level->hierarchy->type].writebacks++;
+}
+
+static double ratio(unsigned long long part, unsigned long long whole)
+{
+  return whole ? (double)part / whole : 0.0;
+}
+
+/* Write the three Cs, the counts per access type and DRAM bytes per type */
+void print_detail_stats(cacheHierarchy* h, FILE* out)
+{
+  cacheLevel* level;
+  detailStats* d;
+  int header = 0;
+  int i;
+  int t;
+
+  if(!h->detailed)
+    return;
+  for(i = 0; i < LEVEL_COUNT; i++)
+  {
+    level = &h->level[i];
+    if(level->classifier == NULL)
+      continue;
+    if(!header)
+      fprintf(out, "Level Type       Hits     Misses   Evicts  Wr-Backs  Compulsory  Capacity  Conflict\n");
+    header = 1;
+    for(t = 0; t < ACCESS_TYPES; t++)
+    {
+      d = &level->type_stats[t];
+      if(d->hits + d->misses + d->evictions + d->writebacks == 0)
+        continue;
+      fprintf(out, "%-5s %-5s %10llu %10llu %8llu  %8llu  %9.1f%%  %7.1f%%  %7.1f%%\n", level->name, type_names[t],
+              d->hits, d->misses, d->evictions, d->writebacks, 100 * ratio(d->miss_class[COMPULSORY], d->misses),
+              100 * ratio(d->miss_class[CAPACITY], d->misses), 100 * ratio(d->miss_class[CONFLICT], d->misses));
+    }
+  }
+  fprintf(out, "DRAM by type:");
+  for(t = 0; t < ACCESS_TYPES; t++)
+    fprintf(out, "%s %s %llu/%llu", t ? "," : "", type_names[t], h->dram_bytes[t][READ], h->dram_bytes[t][WRITE]);
+  fprintf(out, " bytes read/written\n");
+}
+
+/* Write the counts of every set of level that has been used */
+void print_set_stats(cacheLevel* level, FILE* out)
+{
+  detailStats* d;
+  unsigned int i;
+
+  if(level->set_stats == NULL)
+  {
+    fprintf(out, "No detailed statistics for %s; use detail on\n", level->name);
+    return;
+  }
+  fprintf(out, "%s set       Hits     Misses   Evicts  Wr-Backs  Compulsory  Capacity  Conflict\n", level->name);
+  for(i = 0; i < level->set_count; i++)
+  {
+    d = &level->set_stats[i];
+    if(d->hits + d->misses != 0)
+      fprintf(out, "%9u %10llu %10llu %8llu  %8llu  %10llu  %8llu  %8llu\n", i, d->hits, d->misses,
+              d->evictions, d->writebacks, d->miss_class[COMPULSORY], d->miss_class[CAPACITY], d->miss_class[CONFLICT]);
+  }
+}
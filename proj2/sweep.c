@@ -0,0 +1,496 @@
+#include "tips.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+/*
+  Parameter sweeps: run one address trace through many independent,
+  tags-only cache hierarchies at once. Every point of the sweep is a copy
+  of the configured hierarchy with one level's set count, associativity,
+  block size, replacement policy and sync policy taken from the lists
+  given, in every combination.
+
+  The main thread parses the trace into chunks of SWEEP_CHUNK records.
+  While the workers run every point over one chunk, taking points from a
+  shared counter, the main thread parses the next one into the other
+  buffer.
+*/
+
+#define SWEEP_CHUNK 65536
+#define SWEEP_MAX_VALUES 32
+
+typedef struct {
+  unsigned int label;
+  address addr;
+} sweepRecord;
+
+typedef struct {
+  int values[SWEEP_MAX_VALUES];
+  int count;
+} sweepList;
+
+static struct {
+  cacheHierarchy* points;
+  int point_count;
+  sweepRecord* chunk[2];
+  int length[2];
+  int filling;                 /* buffer the parser is filling */
+  int current;                 /* buffer the workers are running */
+  int generation;              /* bumped for each chunk handed over */
+  int next_point;              /* next point to run over the chunk */
+  int busy;                    /* workers still on the chunk */
+  int threads;
+  unsigned long long accesses;
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+} sweep;
+
+static void* sweep_worker(void* unused)
+{
+  int seen = 0;
+  int buffer;
+  int length;
+  int p;
+  int i;
+  sweepRecord* r;
+
+  for(;;)
+  {
+    pthread_mutex_lock(&sweep.lock);
+    while(sweep.generation == seen)
+      pthread_cond_wait(&sweep.start, &sweep.lock);
+    seen = sweep.generation;
+    buffer = sweep.current;
+    length = sweep.length[buffer];
+    pthread_mutex_unlock(&sweep.lock);
+
+    if(length == 0)
+      return NULL;
+
+    for(;;)
+    {
+      pthread_mutex_lock(&sweep.lock);
+      p = sweep.next_point++;
+      pthread_mutex_unlock(&sweep.lock);
+      if(p >= sweep.point_count)
+        break;
+
+      r = sweep.chunk[buffer];
+      for(i = 0; i < length; i++)
+        trace_record(&sweep.points[p], r[i].label, r[i].addr);
+    }
+
+    pthread_mutex_lock(&sweep.lock);
+    if(--sweep.busy == 0)
+      pthread_cond_signal(&sweep.done);
+    pthread_mutex_unlock(&sweep.lock);
+  }
+}
+
+/* Wait for the workers to finish the last chunk, then hand them the one just filled */
+static void hand_over()
+{
+  pthread_mutex_lock(&sweep.lock);
+  while(sweep.busy > 0)
+    pthread_cond_wait(&sweep.done, &sweep.lock);
+  sweep.current = sweep.filling;
+  sweep.next_point = 0;
+  sweep.busy = sweep.threads;
+  sweep.generation++;
+  pthread_cond_broadcast(&sweep.start);
+  pthread_mutex_unlock(&sweep.lock);
+
+  sweep.filling ^= 1;
+  sweep.length[sweep.filling] = 0;
+}
+
+static void sweep_access(void* unused, unsigned int label, address addr)
+{
+  sweepRecord* r;
+
+  if(label > 2 && label != 4)
+    return;
+  if(label <= 2)
+    sweep.accesses++;
+  r = &sweep.chunk[sweep.filling][sweep.length[sweep.filling]++];
+  r->label = label;
+  r->addr = addr;
+  if(sweep.length[sweep.filling] == SWEEP_CHUNK)
+    hand_over();
+}
+
+/*
+  Parse "a,b,c" as a list of values, or "a:b" as the powers of two
+  from a to b. Policy names are translated by names.
+*/
+static int parse_list(char* text, sweepList* list, char** names, int name_count)
+{
+  char* item;
+  int low;
+  int high;
+  int i;
+
+  list->count = 0;
+  if(names == NULL && strchr(text, ':') != NULL)
+  {
+    low = atoi(text);
+    high = atoi(strchr(text, ':') + 1);
+    if(low < 1 || high < low)
+      return -1;
+    for(; low <= high && list->count < SWEEP_MAX_VALUES; low *= 2)
+      list->values[list->count++] = low;
+    return 0;
+  }
+
+  for(item = strtok(text, ","); item != NULL; item = strtok(NULL, ","))
+  {
+    if(list->count == SWEEP_MAX_VALUES)
+      return -1;
+    if(names == NULL)
+      list->values[list->count++] = atoi(item);
+    else
+    {
+      for(i = 0; i < name_count && strcmp(item, names[i]) != 0; i++)
+        ;
+      if(i == name_count)
+        return -1;
+      list->values[list->count++] = i;
+    }
+  }
+  return list->count == 0 ? -1 : 0;
+}
+
+/*
+  Exit with an error unless every value of list is from low to high and,
+  with power_of_two, a power of two. Unlike the level command, a sweep
+  doesn't round values, so each point is the configuration asked for.
+*/
+static void check_list(const char* option, sweepList* list, int low, int high, int power_of_two)
+{
+  int i;
+  int v;
+
+  for(i = 0; i < list->count; i++)
+  {
+    v = list->values[i];
+    if(v < low || v > high || (power_of_two && (v & (v - 1)) != 0))
+    {
+      fprintf(stderr, "Invalid value for %s: %d (must be %sfrom %d to %d)\n", option, v,
+              power_of_two ? "a power of two " : "", low, high);
+      exit(1);
+    }
+  }
+}
+
+/* Mean cycles per access of a point */
+static double amat(cacheHierarchy* h)
+{
+  unsigned long long accesses = h->timing.accesses[DATA_ACCESS] + h->timing.accesses[INSTRUCTION_FETCH];
+
+  return accesses ? (double)(h->timing.access_cycles[DATA_ACCESS] + h->timing.access_cycles[INSTRUCTION_FETCH]) / accesses : 0.0;
+}
+
+static void print_csv(FILE* out, int swept)
+{
+  cacheLevel* level;
+  cacheStats* s;
+  int p;
+  int l;
+
+  fprintf(out, "level,sets,assoc,block_size,size,policy,sync,accesses");
+  for(l = 0; l < LEVEL_COUNT; l++)
+    fprintf(out, ",%s_accesses,%s_misses,%s_miss_rate,%s_writebacks", hierarchy.level[l].name,
+            hierarchy.level[l].name, hierarchy.level[l].name, hierarchy.level[l].name);
+  fprintf(out, ",dram_bytes_read,dram_bytes_written,amat,cycles\n");
+
+  for(p = 0; p < sweep.point_count; p++)
+  {
+    level = &sweep.points[p].level[swept];
+    fprintf(out, "%s,%u,%u,%u,%u,%s,%s,%llu", level->name, level->set_count, level->assoc,
+            level->block_size, level->set_count * level->assoc * level->block_size,
+            replacement_policies[level->policy].key, level->memory_sync_policy == WRITE_BACK ? "wb" : "wt",
+            sweep.accesses);
+    for(l = 0; l < LEVEL_COUNT; l++)
+    {
+      s = &sweep.points[p].level[l].stats;
+      fprintf(out, ",%llu,%llu,%.6f,%llu", s->reads + s->writes, s->read_misses + s->write_misses,
+              s->reads + s->writes ? (double)(s->read_misses + s->write_misses) / (s->reads + s->writes) : 0.0,
+              s->writebacks);
+    }
+    fprintf(out, ",%llu,%llu,%.4f,%llu\n", sweep.points[p].dram_reads, sweep.points[p].dram_writes,
+            amat(&sweep.points[p]), sweep.points[p].timing.cycles);
+  }
+}
+
+static void print_json(FILE* out, int swept)
+{
+  cacheLevel* level;
+  cacheStats* s;
+  int p;
+  int l;
+
+  fprintf(out, "[\n");
+  for(p = 0; p < sweep.point_count; p++)
+  {
+    level = &sweep.points[p].level[swept];
+    fprintf(out, "  {\"level\": \"%s\", \"sets\": %u, \"assoc\": %u, \"block_size\": %u, \"size\": %u, "
+            "\"policy\": \"%s\", \"sync\": \"%s\", \"accesses\": %llu, \"levels\": {",
+            level->name, level->set_count, level->assoc, level->block_size,
+            level->set_count * level->assoc * level->block_size, replacement_policies[level->policy].key,
+            level->memory_sync_policy == WRITE_BACK ? "write back" : "write through", sweep.accesses);
+    for(l = 0; l < LEVEL_COUNT; l++)
+    {
+      s = &sweep.points[p].level[l].stats;
+      fprintf(out, "%s\"%s\": {\"reads\": %llu, \"writes\": %llu, \"read_misses\": %llu, \"write_misses\": %llu, "
+              "\"evictions\": %llu, \"writebacks\": %llu, \"prefetches\": %llu, \"useful_prefetches\": %llu, "
+              "\"victim_hits\": %llu}",
+              l ? ", " : "", hierarchy.level[l].name, s->reads, s->writes, s->read_misses, s->write_misses,
+              s->evictions, s->writebacks, s->prefetches, s->useful_prefetches, s->victim_hits);
+    }
+    fprintf(out, "}, \"dram_bytes_read\": %llu, \"dram_bytes_written\": %llu, \"amat\": %.4f, \"cycles\": %llu}%s\n",
+            sweep.points[p].dram_reads, sweep.points[p].dram_writes, amat(&sweep.points[p]),
+            sweep.points[p].timing.cycles, p + 1 < sweep.point_count ? "," : "");
+  }
+  fprintf(out, "]\n");
+}
+
+static void sweep_usage()
+{
+  fprintf(stderr,
+          "Usage: %s -sweep <trace file> [options]\n"
+          "  -c <command file>   commands such as level to run first (the base hierarchy)\n"
+          "  -level <level>      level to sweep: l1i, l1d (the default), l2 or l3\n"
+          "  -sets <list>        set counts, powers of 2 up to %d, e.g. 64,128 or 64:4096\n"
+          "  -assoc <list>       associativities, up to %d\n"
+          "  -block <list>       block sizes, powers of 2 from 4 to %d\n"
+          "  -policy <list>      replacement policies: lru, lfu, plru, nru, r\n"
+          "  -sync <list>        sync policies: wb, wt\n"
+          "  -threads <n>        worker threads (default: one per processor)\n"
+          "  -format csv|json    output format (default csv)\n"
+          "  -o <file>           output file (default standard output)\n",
+          program_name, MAX_SETS, MAX_ASSOC, MAX_BLOCK_SIZE);
+  exit(1);
+}
+
+/*
+  tips -sweep <trace file> [options]: run the trace through every
+  combination of the parameters given and write a table of results
+*/
+void activate_sweep(int argc, char** argv)
+{
+  static char* level_names[] = { "l1i", "l1d", "l2", "l3" };
+  static char* policy_names[] = { "r", "lru", "lfu", "plru", "nru" };
+  static char* sync_names[] = { "wb", "wt" };
+  sweepList sets;
+  sweepList ways;
+  sweepList blocks;
+  sweepList policies;
+  sweepList syncs;
+  sweepList swept;
+  cacheLevel* base;
+  cacheLevel* level;
+  pthread_t* workers;
+  FILE* commands = NULL;
+  FILE* in;
+  FILE* out = stdout;
+  char input[200];
+  int json = 0;
+  int a, b, c, d, e;
+  int i;
+  int p;
+  int l;
+  unsigned long long malformed = 0;
+  time_t started;
+  int saved;
+  int result = 0;
+
+  if(argc < 3)
+    sweep_usage();
+
+  sweep.threads = sysconf(_SC_NPROCESSORS_ONLN);
+  swept.values[0] = L1D;
+  sets.count = ways.count = blocks.count = policies.count = syncs.count = 0;
+  for(i = 3; i + 1 < argc; i += 2)
+  {
+    if(strcmp(argv[i], "-c") == 0)
+    {
+      if(commands != NULL)
+        fclose(commands);
+      if((commands = fopen(argv[i + 1], "r")) == NULL)
+      {
+        fprintf(stderr, "Unable to open [%s]\n", argv[i + 1]);
+        exit(1);
+      }
+      result = 0;
+    }
+    else if(strcmp(argv[i], "-o") == 0)
+    {
+      if(out != stdout)
+        fclose(out);
+      if((out = fopen(argv[i + 1], "w")) == NULL)
+      {
+        fprintf(stderr, "Unable to write [%s]\n", argv[i + 1]);
+        exit(1);
+      }
+      result = 0;
+    }
+    else if(strcmp(argv[i], "-level") == 0)
+      result = parse_list(argv[i + 1], &swept, level_names, LEVEL_COUNT) || swept.count != 1;
+    else if(strcmp(argv[i], "-sets") == 0)
+    {
+      result = parse_list(argv[i + 1], &sets, NULL, 0);
+      if(result == 0)
+        check_list(argv[i], &sets, 1, MAX_SETS, 1);
+    }
+    else if(strcmp(argv[i], "-assoc") == 0)
+    {
+      result = parse_list(argv[i + 1], &ways, NULL, 0);
+      if(result == 0)
+        check_list(argv[i], &ways, 1, MAX_ASSOC, 0);
+    }
+    else if(strcmp(argv[i], "-block") == 0)
+    {
+      result = parse_list(argv[i + 1], &blocks, NULL, 0);
+      if(result == 0)
+        check_list(argv[i], &blocks, 4, MAX_BLOCK_SIZE, 1);
+    }
+    else if(strcmp(argv[i], "-policy") == 0)
+      result = parse_list(argv[i + 1], &policies, policy_names, POLICY_COUNT);
+    else if(strcmp(argv[i], "-sync") == 0)
+      result = parse_list(argv[i + 1], &syncs, sync_names, 2);
+    else if(strcmp(argv[i], "-threads") == 0)
+      result = (sweep.threads = atoi(argv[i + 1])) < 1;
+    else if(strcmp(argv[i], "-format") == 0)
+    {
+      json = strcmp(argv[i + 1], "json") == 0;
+      result = !json && strcmp(argv[i + 1], "csv") != 0;
+    }
+    else
+      sweep_usage();
+
+    if(result != 0)
+    {
+      fprintf(stderr, "Invalid value for %s: %s\n", argv[i], argv[i + 1]);
+      exit(1);
+    }
+  }
+  if(i != argc)
+    sweep_usage();
+  if(sweep.threads < 1)
+    sweep.threads = 1;
+
+  /* The base hierarchy */
+  if(commands != NULL)
+  {
+    /* Keep what the commands print out of the results */
+    fflush(stdout);
+    saved = dup(1);
+    dup2(2, 1);
+    while(fgets(input, 200, commands) != NULL)
+      if(!execute_command(input))
+        break;
+    fclose(commands);
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+  }
+  base = &hierarchy.level[swept.values[0]];
+  if(sets.count == 0)
+    sets.values[sets.count++] = base->set_count;
+  if(ways.count == 0)
+    ways.values[ways.count++] = base->assoc;
+  if(blocks.count == 0)
+    blocks.values[blocks.count++] = base->block_size;
+  if(policies.count == 0)
+    policies.values[policies.count++] = base->policy;
+  if(syncs.count == 0)
+    syncs.values[syncs.count++] = base->memory_sync_policy;
+  if(sets.values[0] == 0 || ways.values[0] == 0 || blocks.values[0] == 0)
+  {
+    fprintf(stderr, "%s is not configured: give -sets, -assoc and -block, or configure it with -c\n", base->name);
+    exit(1);
+  }
+
+  /* Build every point */
+  sweep.point_count = sets.count * ways.count * blocks.count * policies.count * syncs.count;
+  sweep.points = calloc(sweep.point_count, sizeof(cacheHierarchy));
+  sweep.chunk[0] = malloc(sizeof(sweepRecord) * SWEEP_CHUNK);
+  sweep.chunk[1] = malloc(sizeof(sweepRecord) * SWEEP_CHUNK);
+  if(sweep.points == NULL || sweep.chunk[0] == NULL || sweep.chunk[1] == NULL)
+  {
+    fprintf(stderr, "Unable to allocate the sweep\n");
+    exit(1);
+  }
+  p = 0;
+  for(a = 0; a < sets.count; a++)
+    for(b = 0; b < ways.count; b++)
+      for(c = 0; c < blocks.count; c++)
+        for(d = 0; d < policies.count; d++)
+          for(e = 0; e < syncs.count; e++, p++)
+          {
+            init_hierarchy(&sweep.points[p]);
+            sweep.points[p].tags_only = 1;
+            for(l = 0; l < LEVEL_COUNT; l++)
+            {
+              level = &sweep.points[p].level[l];
+              level->set_count = hierarchy.level[l].set_count;
+              level->assoc = hierarchy.level[l].assoc;
+              level->block_size = hierarchy.level[l].block_size;
+              level->policy = hierarchy.level[l].policy;
+              level->memory_sync_policy = hierarchy.level[l].memory_sync_policy;
+              level->inclusion = hierarchy.level[l].inclusion;
+              level->prefetch = hierarchy.level[l].prefetch;
+              level->prefetch_degree = hierarchy.level[l].prefetch_degree;
+              level->prefetch_distance = hierarchy.level[l].prefetch_distance;
+              level->victim = hierarchy.level[l].victim;
+              level->victim_entries = hierarchy.level[l].victim_entries;
+              level->hit_latency = hierarchy.level[l].hit_latency;
+            }
+            sweep.points[p].write_buffer.entries = hierarchy.write_buffer.entries;
+            sweep.points[p].write_buffer.drain = hierarchy.write_buffer.drain;
+            sweep.points[p].write_buffer.drain_interval = hierarchy.write_buffer.drain_interval;
+            sweep.points[p].dram_latency = hierarchy.dram_latency;
+            sweep.points[p].dram_bandwidth = hierarchy.dram_bandwidth;
+            level = &sweep.points[p].level[swept.values[0]];
+            validate_level_parameters(level, sets.values[a], ways.values[b], blocks.values[c]);
+            level->policy = policies.values[d];
+            level->memory_sync_policy = syncs.values[e];
+            allocate_hierarchy(&sweep.points[p]);
+          }
+
+  if((in = open_trace(argv[2])) == NULL)
+    exit(1);
+  if(stride_prefetching(&hierarchy))
+    fprintf(stderr, "Traces carry no PCs: stride prefetching is off for this sweep\n");
+  fprintf(stderr, "Sweeping %d configurations of %s on %d threads\n", sweep.point_count, base->name, sweep.threads);
+  started = time(NULL);
+
+  pthread_mutex_init(&sweep.lock, NULL);
+  pthread_cond_init(&sweep.start, NULL);
+  pthread_cond_init(&sweep.done, NULL);
+  workers = malloc(sizeof(pthread_t) * sweep.threads);
+  for(i = 0; i < sweep.threads; i++)
+    pthread_create(&workers[i], NULL, sweep_worker, NULL);
+
+  result = read_trace(in, sweep_access, NULL, &malformed);
+  if(sweep.length[sweep.filling] != 0)
+    hand_over();
+  hand_over();                 /* an empty chunk stops the workers */
+  for(i = 0; i < sweep.threads; i++)
+    pthread_join(workers[i], NULL);
+  if(in != stdin)
+    fclose(in);
+
+  if(malformed)
+    fprintf(stderr, "%llu trace records ignored\n", malformed);
+  fprintf(stderr, "Finished in %ld seconds\n", (long)(time(NULL) - started));
+
+  if(json)
+    print_json(out, swept.values[0]);
+  else
+    print_csv(out, swept.values[0]);
+  if(out != stdout)
+    fclose(out);
+  exit(result == 0 ? 0 : 1);
+}
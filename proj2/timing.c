@@ -0,0 +1,58 @@
+#include "tips.h"
+
+/*
+  Timing model. Every access to a level costs its hit latency, found or
+  not, and a DRAM transfer costs dram_latency plus a cycle for every
+  dram_bandwidth bytes, so a miss pays for each level it goes through on
+  the way down and back. Everything a demand access does at the time
+  counts, write backs and write-through stores included, as nothing
+  overlaps them. Prefetches and write buffer drains happen in the
+  background and cost nothing; a store that finds the write buffer full
+  waits for the oldest entry to be written.
+
+  The processor issues one instruction a cycle and stalls on any access
+  that takes longer than a hit in the first level it goes to. Each fetch
+  starts an instruction, so traces with fetches are timed the same way.
+*/
+
+/* Cycles to move size bytes to or from DRAM */
+unsigned int dram_cycles(cacheHierarchy* h, unsigned int size)
+{
+  unsigned int bandwidth = h->dram_bandwidth ? h->dram_bandwidth : 1;
+
+  return h->dram_latency + (size + bandwidth - 1) / bandwidth;
+}
+
+/* Count an access of kind that took cycles */
+void record_access(cacheHierarchy* h, AccessKind kind, unsigned long long cycles)
+{
+  timingStats* t = &h->timing;
+  unsigned int hit = h->first[kind] != NULL ? h->first[kind]->hit_latency : 0;
+  unsigned long long stall = cycles > hit ? cycles - hit : 0;
+
+  t->accesses[kind]++;
+  t->access_cycles[kind] += cycles;
+  t->stall_cycles += stall;
+  t->cycles += stall + (kind == INSTRUCTION_FETCH);
+}
+
+static double mean(unsigned long long total, unsigned long long count)
+{
+  return count ? (double)total / count : 0.0;
+}
+
+void print_timing_stats(cacheHierarchy* h, FILE* out)
+{
+  timingStats* t = &h->timing;
+
+  fprintf(out, "AMAT  %.2f cycles for data, %.2f for fetches, %.2f overall\n",
+          mean(t->access_cycles[DATA_ACCESS], t->accesses[DATA_ACCESS]),
+          mean(t->access_cycles[INSTRUCTION_FETCH], t->accesses[INSTRUCTION_FETCH]),
+          mean(t->access_cycles[DATA_ACCESS] + t->access_cycles[INSTRUCTION_FETCH],
+               t->accesses[DATA_ACCESS] + t->accesses[INSTRUCTION_FETCH]));
+  if(t->accesses[INSTRUCTION_FETCH] != 0)
+    fprintf(out, "Time  %llu cycles for %llu instructions, CPI %.3f (%llu stall cycles)\n", t->cycles,
+            t->accesses[INSTRUCTION_FETCH], mean(t->cycles, t->accesses[INSTRUCTION_FETCH]), t->stall_cycles);
+  else
+    fprintf(out, "Time  %llu stall cycles; no instruction fetches to time\n", t->stall_cycles);
+}
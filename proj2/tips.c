@@ -6,36 +6,47 @@ char* program_name;
 CacheView view;
 int gui_active;
 
-void validate_cache_parameters(int set_count_value, int assoc_value, int block_size_value)
+void validate_level_parameters(cacheLevel* level, int set_count_value, int assoc_value, int block_size_value)
 {
   if(assoc_value < 0)
-    assoc = 0;
+    level->assoc = 0;
   else if(assoc_value > MAX_ASSOC)
-    assoc = MAX_ASSOC;
+    level->assoc = MAX_ASSOC;
   else
-    assoc = assoc_value;
+    level->assoc = assoc_value;
 
   if(set_count_value < 0)
-    set_count = 0;
+    level->set_count = 0;
   else if(set_count_value > MAX_SETS)
-    set_count = MAX_SETS;
+    level->set_count = MAX_SETS;
   else if(set_count_value != 0)
-    set_count = 1 << uint_log2(set_count_value);
+    level->set_count = 1 << uint_log2(set_count_value);
   else
-    set_count = 0;
+    level->set_count = 0;
 
   if(block_size_value < 0)
-    block_size = 0;
+    level->block_size = 0;
   else if(block_size_value > MAX_BLOCK_SIZE)
-    block_size = MAX_BLOCK_SIZE;
+    level->block_size = MAX_BLOCK_SIZE;
   else if(block_size_value != 0)
   {
-    block_size = 1 << uint_log2(block_size_value);    
-    if(block_size == 1 || block_size == 2)
-      block_size = 4;
+    level->block_size = 1 << uint_log2(block_size_value);    
+    if(level->block_size == 1 || level->block_size == 2)
+      level->block_size = 4;
   } 
   else
-    block_size = 0;
+    level->block_size = 0;
+}
+
+void validate_cache_parameters(int set_count_value, int assoc_value, int block_size_value)
+{
+  cacheLevel* l1d = &hierarchy.level[L1D];
+
+  validate_level_parameters(l1d, set_count_value, assoc_value, block_size_value);
+  set_count = l1d->set_count;
+  assoc = l1d->assoc;
+  block_size = l1d->block_size;
+  allocate_cache();
 }
 
 int load_dumpfile(const char* filename)
@@ -100,6 +111,7 @@ int main(int argc, char** argv)
   policy = LRU;
   view = INDEX;
   memory_sync_policy = WRITE_BACK;
+  log_level = LOG_INSTRUCTION;
 
   /* Initialize memory */
   init_memory();
@@ -107,6 +119,16 @@ int main(int argc, char** argv)
   /* Check for flags */
   if(argc >= 2 && (strcmp(argv[1], "-nogui") == 0))
     gui_active = 0;
+  if(argc >= 2 && (strcmp(argv[1], "-trace") == 0))
+  {
+    gui_active = 0;
+    activate_trace(argc, argv);
+  }
+  if(argc >= 2 && (strcmp(argv[1], "-sweep") == 0))
+  {
+    gui_active = 0;
+    activate_sweep(argc, argv);
+  }
 
   /* Build GUI */
   if(IS_GUI_ACTIVE())
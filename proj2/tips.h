@@ -6,6 +6,7 @@
 #define IS_GUI_ACTIVE() (gui_active == 1)
 
 typedef enum {INDEX, ASSOC} CacheView;
+typedef enum {LOG_OFF, LOG_SUMMARY, LOG_ACCESS, LOG_INSTRUCTION} LogLevel;
 typedef unsigned char byte;
 typedef unsigned int word;
 typedef unsigned int address;
@@ -23,9 +24,14 @@ typedef unsigned int instruction;
 #define STACK_START 0x7fffeffc
 
 /* Define Cache Constants */
-#define MAX_BLOCK_SIZE 32
-#define MAX_SETS 16
-#define MAX_ASSOC 5
+#define MAX_BLOCK_SIZE 128
+#define MAX_SETS 16384
+#define MAX_ASSOC 32
+#define MAX_PREFETCH_DEGREE 16
+#define MAX_STREAMS 16
+#define PREFETCH_QUEUE_SIZE 256
+#define MAX_VICTIM_ENTRIES 64
+#define MAX_WRITE_BUFFER_ENTRIES 64
 
 /* Define Execution Constants */
 #define MIN_SPEED 10
@@ -38,6 +44,7 @@ extern unsigned int registers[32];
 extern unsigned int hilo[2];
 extern address PC;
 extern char* program_name;
+extern LogLevel log_level;
 
 
 /*****************************************************************************
@@ -50,10 +57,10 @@ extern char* program_name;
   Typedef some useful states for variables
 *****************************************************************************/
 
-typedef enum {RANDOM, LRU, LFU} ReplacementPolicy;
+typedef enum {RANDOM, LRU, LFU, PLRU, NRU, POLICY_COUNT} ReplacementPolicy;
 typedef enum {WRITE_BACK, WRITE_THROUGH} MemorySyncPolicy;
 typedef enum {READ, WRITE} WriteEnable;
-typedef enum {BYTE_SIZE = 0, HALF_WORD_SIZE, WORD_SIZE, DOUBLEWORD_SIZE, QUADWORD_SIZE, OCTWORD_SIZE} TransferUnit;
+typedef enum {BYTE_SIZE = 0, HALF_WORD_SIZE, WORD_SIZE, DOUBLEWORD_SIZE, QUADWORD_SIZE, OCTWORD_SIZE, SIXTEEN_WORD_SIZE, THIRTYTWO_WORD_SIZE} TransferUnit;
 typedef enum {HIT, MISS} CacheAction;
 
 /*****************************************************************************
@@ -70,32 +77,279 @@ extern MemorySyncPolicy memory_sync_policy;  /* Memory sync policy        */
    ==================
    valid - assign INVALID if block invalid; assign VALID if block valid
    tag - container for the tag bits; unsigned to allow ignoring sign ext issue
-   data - the data contained in a block
+   data - the data contained in a block (block_size bytes)
    lru.data - pointer to lru information
-   lru.value - int that represents lru information
+   lru.value - number that represents lru information; 64 bits so that
+               LRU stamps never wrap
+   prefetched - nonzero if a prefetcher brought the block in and it hasn't
+                been used since; prefetch_time is the level's access count then
+   shared - nonzero if other cores may hold the block too; with valid and
+            dirty it gives the block's coherence state (see coherence.c)
 */
 typedef struct {
   enum {INVALID, VALID} valid;   
   enum {VIRGIN, DIRTY} dirty;
   unsigned int tag;
-  byte data[MAX_BLOCK_SIZE];
+  byte* data;
   union { 
     void* data;
-    unsigned int value;
+    unsigned long long value;
   } lru;
   int accessCount;
+  int prefetched;
+  unsigned long long prefetch_time;
+  int shared;
 } cacheBlock;
 
 /* Define cache unit
    =================
    block - array that represents a set of blocks with the SAME index
+   state - replacement policy information for the whole set
 */
 typedef struct {
-  cacheBlock block[MAX_ASSOC];
+  cacheBlock* block;
+  unsigned int state;
 } cacheSet;
 
-/* Define actual cache structure that will be manipulated by accessMemory() */
-extern cacheSet cache[MAX_SETS];
+/* Define actual cache structure that will be manipulated by accessMemory().
+   It holds set_count sets of assoc blocks, and is reallocated whenever
+   those change. */
+extern cacheSet* cache;
+
+/*****************************************************************************
+  Define the cache hierarchy. The cache above is its L1 data cache, and
+  the globals above configure that level. Each level holds its own
+  blocks in the same cacheSet/cacheBlock structures.
+*****************************************************************************/
+
+typedef enum {L1I, L1D, L2, L3, LEVEL_COUNT} CacheLevelName;
+typedef enum {NON_INCLUSIVE, INCLUSIVE, EXCLUSIVE} InclusionPolicy;
+typedef enum {DATA_ACCESS, INSTRUCTION_FETCH} AccessKind;
+typedef enum {NO_PREFETCH, NEXT_LINE_PREFETCH, STRIDE_PREFETCH, STREAM_PREFETCH} PrefetchKind;
+typedef enum {NO_VICTIM_CACHE, VICTIM_CACHE, MISS_CACHE} VictimKind;
+typedef enum {DRAIN_EAGER, DRAIN_LAZY} DrainPolicy;
+typedef enum {TYPE_READ, TYPE_WRITE, TYPE_FETCH, ACCESS_TYPES} AccessType;
+typedef enum {COMPULSORY, CAPACITY, CONFLICT, MISS_CLASSES} MissClass;
+
+/* Per-level counters, cleared whenever the cache is flushed */
+typedef struct {
+  unsigned long long reads;
+  unsigned long long writes;
+  unsigned long long read_misses;
+  unsigned long long write_misses;
+  unsigned long long evictions;            /* valid blocks replaced       */
+  unsigned long long writebacks;           /* dirty blocks written below  */
+  unsigned long long back_invalidations;   /* blocks removed from above   */
+  unsigned long long prefetches;           /* blocks fetched by prefetch  */
+  unsigned long long useful_prefetches;    /* used before they left       */
+  unsigned long long useless_prefetches;   /* left unused                 */
+  unsigned long long prefetch_lead;        /* total accesses from prefetch
+                                              to use of the useful ones   */
+  unsigned long long victim_hits;          /* misses recovered from the
+                                              victim or miss cache        */
+} cacheStats;
+
+/* Counters kept per set and per access type while detailed statistics
+   are on; see stats.c */
+typedef struct {
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;
+  unsigned long long writebacks;
+  unsigned long long miss_class[MISS_CLASSES];
+} detailStats;
+
+/* Replacement policy hooks, called with the way (index in the set) of a
+   block; see replacement.c */
+struct cacheLevel;
+typedef struct {
+  char* key;                               /* as the config command takes it */
+  char* name;
+  void (*on_hit)(struct cacheLevel* level, cacheSet* set, unsigned int way);
+  void (*on_fill)(struct cacheLevel* level, cacheSet* set, unsigned int way);
+  unsigned int (*victim)(struct cacheLevel* level, cacheSet* set);
+} replacementPolicy;
+
+extern const replacementPolicy replacement_policies[POLICY_COUNT];
+
+/* Define cache level
+   ==================
+   A level is present when set_count, assoc and block_size are all
+   nonzero. inclusion describes what the level holds relative to the
+   levels above it: everything they hold (INCLUSIVE, enforced by
+   invalidating their copies when a block is evicted), nothing they hold
+   (EXCLUSIVE, filled only by blocks they evict), or no guarantee.
+*/
+typedef struct cacheLevel {
+  char* name;
+  unsigned int set_count;
+  unsigned int assoc;
+  unsigned int block_size;
+  ReplacementPolicy policy;
+  MemorySyncPolicy memory_sync_policy;
+  InclusionPolicy inclusion;
+  const replacementPolicy* replacement;    /* policy's hooks, when allocated */
+  cacheSet* sets;
+  byte* storage;
+  unsigned int offset_bits;
+  unsigned int index_bits;
+  unsigned long long clock;                /* stamps blocks for LRU       */
+  unsigned int seed;                       /* for RANDOM replacement      */
+  struct cacheLevel* next;                 /* level below; NULL is DRAM   */
+  struct cacheLevel* above[2];             /* levels that fill from this  */
+  struct cacheHierarchy* hierarchy;
+  PrefetchKind prefetch;
+  unsigned int prefetch_degree;
+  unsigned int prefetch_distance;
+  struct prefetcher* prefetcher;           /* its state, when allocated   */
+  VictimKind victim;
+  unsigned int victim_entries;
+  cacheBlock* victims;                     /* its entries, when allocated */
+  byte* victim_storage;
+  cacheStats stats;
+  detailStats* set_stats;                  /* per set, when detailed      */
+  detailStats type_stats[ACCESS_TYPES];
+  struct missClassifier* classifier;       /* its state, when detailed    */
+  unsigned int hit_latency;                /* cycles for any access       */
+} cacheLevel;
+
+/* A prefetch waiting for the access that caused it to finish */
+typedef struct {
+  struct cacheLevel* level;
+  address addr;
+} prefetchRequest;
+
+/* The words of one block waiting in the write buffer */
+typedef struct {
+  address addr;                            /* of the block                */
+  unsigned int mask;                       /* bit n set if word n is held */
+  byte data[MAX_BLOCK_SIZE];
+} writeBufferEntry;
+
+/* Write buffer counters, cleared whenever the cache is flushed */
+typedef struct {
+  unsigned long long writes;               /* accepted                    */
+  unsigned long long coalesced;            /* merged into an entry        */
+  unsigned long long bytes_in;             /* accepted                    */
+  unsigned long long retired;              /* entries written to DRAM     */
+  unsigned long long stalls;               /* writes that found it full   */
+  unsigned long long forwards;             /* DRAM reads it supplied data
+                                              for                         */
+} writeBufferStats;
+
+/* Define write buffer
+   ===================
+   Holds writes on their way to DRAM when entries is nonzero, merging
+   those to the same block of block_size bytes, and retires the oldest
+   entry every drain_interval accesses: whenever it holds any (EAGER) or
+   only once it is half full (LAZY). See writebuffer.c.
+*/
+typedef struct {
+  unsigned int entries;
+  DrainPolicy drain;
+  unsigned int drain_interval;
+  unsigned int block_size;
+  writeBufferEntry* entry;                 /* count of them, oldest first */
+  unsigned int count;
+  unsigned int ticks;                      /* accesses since the last slot */
+  writeBufferStats stats;
+} writeBuffer;
+
+/* A level's prefetcher state, defined in prefetch.c */
+typedef struct prefetcher prefetcher;
+
+/* Timing counters, cleared whenever the cache is flushed; see timing.c */
+typedef struct {
+  unsigned long long accesses[2];          /* by AccessKind               */
+  unsigned long long access_cycles[2];
+  unsigned long long stall_cycles;         /* beyond a first-level hit    */
+  unsigned long long cycles;               /* one per fetch, plus stalls  */
+} timingStats;
+
+/* First touches and a shadow LRU cache for the three Cs, defined in stats.c */
+typedef struct missClassifier missClassifier;
+
+/* LRU stack distances for miss-ratio curves, defined in stackdist.c */
+typedef struct stackDistance stackDistance;
+
+typedef struct cacheHierarchy {
+  cacheLevel level[LEVEL_COUNT];
+  cacheLevel* first[2];                    /* indexed by AccessKind       */
+  unsigned long long dram_reads;           /* bytes                       */
+  unsigned long long dram_writes;          /* bytes                       */
+  int tags_only;                           /* nonzero to skip DRAM data;
+                                              set before allocating, the
+                                              blocks hold no data either */
+  stackDistance* profile;                  /* of accesses since the flush */
+  int profile_kinds;                       /* mask of 1 << AccessKind     */
+  address pc;                              /* of the instruction making
+                                              data accesses, for stride
+                                              prefetchers                 */
+  prefetchRequest pending[PREFETCH_QUEUE_SIZE];  /* prefetches to issue */
+  int pending_count;
+  writeBuffer write_buffer;
+  int detailed;                            /* nonzero for per-set stats and
+                                              the three Cs; set before
+                                              allocating                 */
+  AccessType type;                         /* of the processor access
+                                              under way                  */
+  unsigned long long dram_bytes[ACCESS_TYPES][2];  /* by type, READ/WRITE */
+  unsigned int dram_latency;               /* cycles to the first bytes   */
+  unsigned int dram_bandwidth;             /* bytes per cycle after them  */
+  unsigned long long latency;              /* cycles of the access under
+                                              way so far                  */
+  timingStats timing;
+} cacheHierarchy;
+
+/* The hierarchy behind accessMemory() and the cache display */
+extern cacheHierarchy hierarchy;
+
+/* Define cores
+   ============
+   Several cores can run the program, each with its own registers and a
+   private cache shaped like the L1 data cache, kept coherent by snooping
+   a shared bus; see coherence.c
+*/
+#define MAX_CORES 8
+#define CORE_STACK_SIZE 1024                 /* bytes of stack per core */
+
+typedef enum {MESI, MOESI} CoherenceProtocol;
+typedef enum {BUS_READ, BUS_READ_EXCLUSIVE, BUS_UPGRADE, BUS_WRITEBACK, BUS_TRANSACTIONS} BusTransaction;
+
+typedef struct {
+  word registers[32];
+  word hilo[2];
+  address PC;
+} cpuState;
+
+/* Per-core counters, cleared whenever the caches are flushed */
+typedef struct {
+  unsigned long long coherence_misses;     /* to blocks another core's
+                                              write invalidated here      */
+  unsigned long long invalidations;        /* copies invalidated by others */
+  unsigned long long supplied;             /* blocks sent to other cores  */
+} coherenceStats;
+
+typedef struct {
+  cpuState cpu;                            /* while another core runs     */
+  cacheHierarchy cache;                    /* only its L1D is present     */
+  coherenceStats stats;
+  unsigned int** lost;                     /* bitmap chunks of the blocks
+                                              invalidated by others, NULL
+                                              until one is needed         */
+} processorCore;
+
+typedef struct {
+  int count;                               /* cores, or 0 to run the one
+                                              processor on hierarchy      */
+  int current;                             /* the core running            */
+  CoherenceProtocol protocol;
+  processorCore core[MAX_CORES];
+  unsigned long long transactions[BUS_TRANSACTIONS];
+  unsigned long long cache_transfers;      /* misses filled by other cores */
+} snoopingBus;
+
+extern snoopingBus bus;
 
 /*
   This function should be called when you want to interact with physical memory
@@ -176,11 +430,124 @@ void reverse_endianness(instruction* word);
 
 /* Defined in memory.c */
 void init_memory(void);
+void allocate_cache(void);
 void flush_cache(void);
 
+/* Defined in hierarchy.c */
+void init_hierarchy(cacheHierarchy* h);
+void allocate_hierarchy(cacheHierarchy* h);
+void free_hierarchy(cacheHierarchy* h);
+void flush_hierarchy(cacheHierarchy* h);
+void flush_hierarchy_blocks(cacheHierarchy* h);
+void access_hierarchy(cacheHierarchy* h, AccessKind kind, address addr, word* data, WriteEnable we);
+void print_hierarchy(cacheHierarchy* h, FILE* out);
+void print_hierarchy_stats(cacheHierarchy* h, FILE* out);
+int level_holds(cacheLevel* level, address addr);
+void copy_from_below(cacheLevel* level, address addr, byte* data);
+int prefetch_block(cacheLevel* level, address addr);
+unsigned int set_index(cacheLevel* level, address addr);
+unsigned int tag_of(cacheLevel* level, address addr);
+address block_address(cacheLevel* level, unsigned int index, cacheBlock* block);
+cacheBlock* find_block(cacheLevel* level, address addr);
+void touch(cacheLevel* level, unsigned int index, cacheBlock* block);
+void filled(cacheLevel* level, unsigned int index, cacheBlock* block);
+cacheBlock* choose_victim(cacheLevel* level, cacheSet* set);
+
+/* Defined in replacement.c */
+int parse_replacement_policy(const char* key);
+char* policy_name(ReplacementPolicy p);
+
+/* Defined in prefetch.c */
+int parse_prefetch_kind(const char* name);
+void describe_prefetcher(cacheLevel* level, char* buffer);
+int stride_prefetching(cacheHierarchy* h);
+void allocate_prefetcher(cacheLevel* level);
+void free_prefetcher(cacheLevel* level);
+void flush_prefetcher(cacheLevel* level);
+int take_streamed(cacheLevel* level, address addr, byte* data);
+void drop_streamed(cacheLevel* level, address addr);
+void prefetch_access(cacheLevel* level, address addr, int missed, int hit);
+void issue_prefetches(cacheHierarchy* h);
+void print_prefetch_stats(cacheHierarchy* h, FILE* out);
+
+/* Defined in victim.c */
+int parse_victim_kind(const char* name);
+void describe_victim_cache(cacheLevel* level, char* buffer);
+void allocate_victim_cache(cacheLevel* level);
+void free_victim_cache(cacheLevel* level);
+void flush_victim_cache(cacheLevel* level);
+cacheBlock* victim_lookup(cacheLevel* level, address addr);
+cacheBlock* victim_slot(cacheLevel* level);
+void victim_used(cacheLevel* level, cacheBlock* entry);
+address victim_address(cacheLevel* level, cacheBlock* entry);
+void print_victim_stats(cacheHierarchy* h, FILE* out);
+
+/* Defined in writebuffer.c */
+int parse_drain_policy(const char* name);
+void describe_write_buffer(cacheHierarchy* h, char* buffer);
+void allocate_write_buffer(cacheHierarchy* h);
+void free_write_buffer(cacheHierarchy* h);
+void flush_write_buffer(cacheHierarchy* h);
+void buffer_write(cacheHierarchy* h, address addr, byte* data, unsigned int size);
+int buffer_holds(cacheHierarchy* h, address addr, unsigned int size);
+void forward_buffered(cacheHierarchy* h, address addr, byte* data, unsigned int size);
+void tick_write_buffer(cacheHierarchy* h);
+void print_write_buffer_stats(cacheHierarchy* h, FILE* out);
+
+/* Defined in timing.c */
+unsigned int dram_cycles(cacheHierarchy* h, unsigned int size);
+void record_access(cacheHierarchy* h, AccessKind kind, unsigned long long cycles);
+void print_timing_stats(cacheHierarchy* h, FILE* out);
+
+/* Defined in coherence.c */
+int parse_protocol(const char* key);
+void allocate_cores(void);
+void free_cores(void);
+void flush_cores(void);
+void reset_cores(void);
+void step_cores(void);
+void coherent_access(int id, AccessKind kind, address addr, word* data, WriteEnable we);
+void print_coherence_stats(FILE* out);
+
+/* Defined in stats.c */
+void allocate_detail(cacheLevel* level);
+void free_detail(cacheLevel* level);
+void clear_classifier(cacheLevel* level);
+void count_access(cacheLevel* level, address addr, int missed);
+void count_eviction(cacheLevel* level, address addr);
+void count_writeback(cacheLevel* level, address addr);
+void print_detail_stats(cacheHierarchy* h, FILE* out);
+void print_set_stats(cacheLevel* level, FILE* out);
+
+/* Defined in stackdist.c */
+stackDistance* new_stack_distance(unsigned int block_size);
+void free_stack_distance(stackDistance* sd);
+void stack_distance_access(stackDistance* sd, address addr);
+long long stack_distance_misses(stackDistance* sd, unsigned int set_count, unsigned int assoc);
+void print_miss_ratio_curve(stackDistance* sd, FILE* out);
+void profile_hierarchy(cacheHierarchy* h, unsigned int block_size, int kinds);
+void restart_profile(cacheHierarchy* h);
+
+/* Defined in trace.c */
+typedef void (*TraceHandler)(void* arg, unsigned int label, address addr);
+FILE* open_trace(const char* filename);
+int read_trace(FILE* in, TraceHandler handler, void* arg, unsigned long long* malformed);
+void trace_record(cacheHierarchy* h, unsigned int label, address addr);
+int run_trace(cacheHierarchy* h, const char* filename, FILE* out);
+
+/* Defined in log.c */
+void log_instruction(address pc, word inst);
+void log_dram(address addr, int size, WriteEnable flag);
+void set_log_keep(unsigned int n);
+void dump_log(FILE* out, unsigned int n);
+int parse_log_level(const char* name);
+
 /* Defined in cpu.c */
+void disassemble_inst(word inst, address pc, char* buffer);
 void reinit_processor(void);
 void step_processor(void);
+void save_processor(cpuState* s);
+void load_processor(const cpuState* s);
 
 /* Defined in gui.c */
 int build_gui(int argc, char** argv);
@@ -191,10 +558,17 @@ void flush_drawlist();
 
 /* Defined in nogui.c */
 void activate_no_gui(int argc, char** argv);
+void activate_trace(int argc, char** argv);
+int execute_command(char* input);
+
+/* Defined in sweep.c */
+void activate_sweep(int argc, char** argv);
 
 /* Defined in cachelogic.c */
 void init_lfu(int set_number, int assoc_value);
 void init_lru(int set_number, int assoc_value);
 char* lfu_to_string(int set_number, int assoc_value);
 char* lru_to_string(int set_number, int assoc_value);
+void fetch_instruction(address addr, word* data);
 void validate_cache_parameters(int set_number, int assoc_value, int block_size_value);
+void validate_level_parameters(cacheLevel* level, int set_number, int assoc_value, int block_size_value);
@@ -0,0 +1,271 @@
+#include "tips.h"
+#include <time.h>
+
+/*
+  Trace-driven simulation: feed an address trace straight into the cache
+  hierarchy, without executing anything. Two formats are read, told apart
+  by their first bytes:
+
+    Dinero "din" text - one "<label> <hex address>" line per access, with
+    labels 0 = data read, 1 = data write, 2 = instruction fetch and
+    4 = flush the cache. Anything after the address, and lines with other
+    labels, are ignored.
+
+    Binary, as written by proj1's sim -t - "MTRC", a little-endian version
+    word, then 8-byte records: type (the din label), size, two reserved
+    bytes and a little-endian address.
+
+  The hierarchy only tracks tags while a trace runs, since the addresses
+  need not be in simulated memory.
+*/
+
+#define TRACE_MAGIC "MTRC"
+#define TRACE_VERSION 1
+#define TRACE_RECORD_SIZE 8
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+typedef struct {
+  cacheHierarchy* h;
+  unsigned long long count[3];    /* indexed by din label */
+  unsigned long long flushes;
+  unsigned long long ignored;
+} traceRun;
+
+/* Apply one access with the given din label to h */
+void trace_record(cacheHierarchy* h, unsigned int label, address addr)
+{
+  word data = 0;
+
+  switch(label)
+  {
+  case 0:
+    access_hierarchy(h, DATA_ACCESS, addr & ~3, &data, READ);
+    break;
+  case 1:
+    access_hierarchy(h, DATA_ACCESS, addr & ~3, &data, WRITE);
+    break;
+  case 2:
+    access_hierarchy(h, INSTRUCTION_FETCH, addr & ~3, &data, READ);
+    break;
+  case 4:
+    flush_hierarchy_blocks(h);
+    break;
+  }
+}
+
+static void trace_access(void* arg, unsigned int label, address addr)
+{
+  traceRun* run = arg;
+
+  if(label <= 2)
+    run->count[label]++;
+  else if(label == 4)
+    run->flushes++;
+  else
+  {
+    run->ignored++;
+    return;
+  }
+  trace_record(run->h, label, addr);
+}
+
+static int hex_digit(int c)
+{
+  if(c >= '0' && c <= '9')
+    return c - '0';
+  if(c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+/* Parse the din line from p up to end, which need not be terminated.
+   Returns nonzero if it isn't blank but can't be parsed. */
+static int din_line(TraceHandler handler, void* arg, char* p, char* end)
+{
+  unsigned int label = 0;
+  address addr = 0;
+  int digits = 0;
+  int d;
+
+  while(p < end && (*p == ' ' || *p == '\t'))
+    p++;
+  while(p < end && *p >= '0' && *p <= '9')
+  {
+    label = label * 10 + (*p++ - '0');
+    digits++;
+  }
+  if(digits == 0)
+    return p < end && *p != '\r';
+
+  while(p < end && (*p == ' ' || *p == '\t'))
+    p++;
+  if(end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    p += 2;
+  for(digits = 0; p < end && (d = hex_digit(*p)) >= 0; p++, digits++)
+    addr = addr << 4 | d;
+  if(digits == 0)
+    return 1;
+  handler(arg, label, addr);
+  return 0;
+}
+
+static int read_din(TraceHandler handler, void* arg, FILE* in, char* buffer, size_t have, unsigned long long* malformed)
+{
+  char* line;
+  char* newline;
+  size_t got;
+
+  for(;;)
+  {
+    got = fread(buffer + have, 1, TRACE_BUFFER_SIZE - have, in);
+    have += got;
+    line = buffer;
+    while((newline = memchr(line, '\n', buffer + have - line)) != NULL)
+    {
+      *malformed += din_line(handler, arg, line, newline);
+      line = newline + 1;
+    }
+
+    have = buffer + have - line;
+    if(got == 0)
+    {
+      if(have != 0)
+        *malformed += din_line(handler, arg, line, line + have);
+      return ferror(in) ? -1 : 0;
+    }
+    if(have == TRACE_BUFFER_SIZE)
+    {
+      fprintf(stderr, "Trace line too long\n");
+      return -1;
+    }
+    memmove(buffer, line, have);
+  }
+}
+
+static int read_binary(TraceHandler handler, void* arg, FILE* in, byte* buffer, size_t have)
+{
+  byte* r;
+  size_t got;
+
+  if(have < 8 || (buffer[4] | buffer[5] << 8 | buffer[6] << 16 | (unsigned int)buffer[7] << 24) != TRACE_VERSION)
+  {
+    fprintf(stderr, "Unsupported binary trace version\n");
+    return -1;
+  }
+  memmove(buffer, buffer + 8, have - 8);
+  have -= 8;
+
+  for(;;)
+  {
+    got = fread(buffer + have, 1, TRACE_BUFFER_SIZE - have, in);
+    have += got;
+    for(r = buffer; r + TRACE_RECORD_SIZE <= buffer + have; r += TRACE_RECORD_SIZE)
+      handler(arg, r[0], r[4] | r[5] << 8 | r[6] << 16 | (address)r[7] << 24);
+
+    have = buffer + have - r;
+    if(got == 0)
+    {
+      if(have != 0)
+        fprintf(stderr, "Trace ends in a partial record\n");
+      return ferror(in) ? -1 : 0;
+    }
+    memmove(buffer, r, have);
+  }
+}
+
+/*
+  Pass each access in the trace read from in to handler, with its din
+  label. Lines of a din trace that can't be parsed are counted in
+  malformed. Returns 0 on success.
+*/
+int read_trace(FILE* in, TraceHandler handler, void* arg, unsigned long long* malformed)
+{
+  byte* buffer = malloc(TRACE_BUFFER_SIZE);
+  size_t have;
+  int result;
+
+  if(buffer == NULL)
+  {
+    fprintf(stderr, "Unable to allocate the trace buffer\n");
+    exit(1);
+  }
+
+  have = fread(buffer, 1, 8, in);
+  if(have >= 4 && memcmp(buffer, TRACE_MAGIC, 4) == 0)
+    result = read_binary(handler, arg, in, buffer, have);
+  else
+    result = read_din(handler, arg, in, (char*)buffer, have, malformed);
+
+  free(buffer);
+  return result;
+}
+
+/*
+  Open a trace file, or standard input for "-"
+*/
+FILE* open_trace(const char* filename)
+{
+  FILE* in = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "rb");
+
+  if(in == NULL)
+    fprintf(stderr, "Unable to open trace [%s]\n", filename);
+  return in;
+}
+
+/*
+  Run the trace in filename ("-" for standard input) through h from a
+  flushed state and print a summary to out. The blocks are invalidated
+  again afterwards, as they hold no data, but the statistics are kept.
+  Returns 0 on success.
+*/
+int run_trace(cacheHierarchy* h, const char* filename, FILE* out)
+{
+  traceRun run;
+  FILE* in;
+  clock_t start;
+  double seconds;
+  unsigned long long total;
+  int result;
+
+  if((in = open_trace(filename)) == NULL)
+    return -1;
+
+  if(stride_prefetching(h))
+    fprintf(out, "Traces carry no PCs: stride prefetching is off for this run\n");
+  memset(&run, 0, sizeof(run));
+  run.h = h;
+  flush_hierarchy(h);
+  h->tags_only = 1;
+  start = clock();
+
+  result = read_trace(in, trace_access, &run, &run.ignored);
+
+  seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  if(in != stdin)
+    fclose(in);
+
+  total = run.count[0] + run.count[1] + run.count[2];
+  fprintf(out, "Trace [%s]: %llu accesses (%llu reads, %llu writes, %llu fetches)",
+          filename, total, run.count[0], run.count[1], run.count[2]);
+  if(run.flushes)
+    fprintf(out, ", %llu flushes", run.flushes);
+  if(run.ignored)
+    fprintf(out, ", %llu records ignored", run.ignored);
+  fprintf(out, "\n");
+  if(seconds > 0)
+    fprintf(out, "%.2f seconds, %.0f accesses per second\n", seconds, total / seconds);
+  print_hierarchy(h, out);
+  print_hierarchy_stats(h, out);
+  if(h->profile != NULL)
+  {
+    fprintf(out, "\n");
+    print_miss_ratio_curve(h->profile, out);
+  }
+
+  /* Still tags-only, so the write buffer's entries, which hold no data, aren't written to DRAM */
+  flush_hierarchy_blocks(h);
+  h->tags_only = 0;
+  return result;
+}
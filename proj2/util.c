@@ -21,3 +21,15 @@ unsigned int uint_log2(unsigned int w)
 int randomint( int x ) { 
   return rand()%x;
 }
+
+/* return random int from 0..x-1 from the generator state *seed, so
+   independent caches can each have their own */
+int randomint_r( unsigned int* seed, int x ) {
+  unsigned int s = *seed ? *seed : 1;
+
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  *seed = s;
+  return s % x;
+}
@@ -3,3 +3,6 @@ unsigned int uint_log2(unsigned int w);
 
 /* return random int from 0..x-1 */
 int randomint( int x );
+
+/* return random int from 0..x-1 from the generator state *seed */
+int randomint_r( unsigned int* seed, int x );
@@ -0,0 +1,150 @@
+#include "tips.h"
+
+/*
+  Victim and miss caches: a small fully associative buffer of whole
+  blocks beside a level, between it and the level below, replaced LRU.
+
+    VICTIM  holds the blocks the level evicts, dirty or not. A miss that
+            finds its block here swaps it with the block the level
+            replaces, so only blocks pushed out of here go below.
+    MISS    holds a clean copy of each block the level fetches from
+            below. A miss that finds its block here copies it back. The
+            copy is refreshed when the level evicts the block, so it is
+            never older than the level below.
+
+  Either way the level counts a block found here as a hit, and
+  victim_hits counts the misses recovered. Exclusive levels have neither,
+  as blocks reach them from above without going through the usual miss
+  path.
+*/
+
+static char* victim_names[] = { "none", "victim", "miss" };
+
+/* The victim cache kind called name, or -1 */
+int parse_victim_kind(const char* name)
+{
+  int i;
+
+  for(i = 0; i <= MISS_CACHE; i++)
+    if(strcmp(name, victim_names[i]) == 0)
+      return i;
+  return -1;
+}
+
+/* Write a description of level's victim or miss cache into buffer */
+void describe_victim_cache(cacheLevel* level, char* buffer)
+{
+  if(level->victim == NO_VICTIM_CACHE)
+    buffer[0] = '\0';
+  else
+    sprintf(buffer, "%u-entry %s cache%s", level->victim_entries, victim_names[level->victim],
+            level->inclusion == EXCLUSIVE ? " (unused)" : "");
+}
+
+/* Allocate level's victim or miss cache, freeing the old one */
+void allocate_victim_cache(cacheLevel* level)
+{
+  unsigned int stride = level->hierarchy->tags_only ? 0 : level->block_size;
+  unsigned int i;
+
+  free_victim_cache(level);
+  if(level->victim == NO_VICTIM_CACHE || level->victim_entries == 0 || level->inclusion == EXCLUSIVE)
+    return;
+
+  level->victims = calloc(level->victim_entries, sizeof(cacheBlock));
+  level->victim_storage = stride ? calloc(level->victim_entries, stride) : calloc(1, MAX_BLOCK_SIZE);
+  if(level->victims == NULL || level->victim_storage == NULL)
+  {
+    fprintf(stderr, "Unable to allocate the %s %s cache\n", level->name, victim_names[level->victim]);
+    exit(1);
+  }
+  for(i = 0; i < level->victim_entries; i++)
+    level->victims[i].data = level->victim_storage + (size_t)i * stride;
+}
+
+void free_victim_cache(cacheLevel* level)
+{
+  free(level->victims);
+  free(level->victim_storage);
+  level->victims = NULL;
+  level->victim_storage = NULL;
+}
+
+/* Invalidate every entry without writing anything back */
+void flush_victim_cache(cacheLevel* level)
+{
+  unsigned int i;
+
+  if(level->victims == NULL)
+    return;
+  for(i = 0; i < level->victim_entries; i++)
+  {
+    level->victims[i].valid = INVALID;
+    level->victims[i].dirty = VIRGIN;
+    level->victims[i].lru.value = 0;
+  }
+}
+
+/* The entry holding the block at addr, or NULL */
+cacheBlock* victim_lookup(cacheLevel* level, address addr)
+{
+  unsigned int tag = addr >> level->offset_bits;
+  unsigned int i;
+
+  if(level->victims == NULL)
+    return NULL;
+  for(i = 0; i < level->victim_entries; i++)
+    if(level->victims[i].valid == VALID && level->victims[i].tag == tag)
+      return &level->victims[i];
+  return NULL;
+}
+
+/* The entry to fill next: an invalid one, or else the least recently used */
+cacheBlock* victim_slot(cacheLevel* level)
+{
+  cacheBlock* slot = &level->victims[0];
+  unsigned int i;
+
+  for(i = 0; i < level->victim_entries; i++)
+  {
+    if(level->victims[i].valid == INVALID)
+      return &level->victims[i];
+    if(level->victims[i].lru.value < slot->lru.value)
+      slot = &level->victims[i];
+  }
+  return slot;
+}
+
+void victim_used(cacheLevel* level, cacheBlock* entry)
+{
+  entry->lru.value = ++level->clock;
+}
+
+address victim_address(cacheLevel* level, cacheBlock* entry)
+{
+  return entry->tag << level->offset_bits;
+}
+
+/* Write the statistics of every level with a victim or miss cache */
+void print_victim_stats(cacheHierarchy* h, FILE* out)
+{
+  cacheLevel* level;
+  cacheStats* s;
+  unsigned long long misses;
+  int header = 0;
+  int i;
+
+  for(i = 0; i < LEVEL_COUNT; i++)
+  {
+    level = &h->level[i];
+    if(level->victims == NULL || level->set_count == 0)
+      continue;
+    if(!header)
+      fprintf(out, "Victim   Kind    Entries   Recovered  Of-Misses\n");
+    header = 1;
+    s = &level->stats;
+    misses = s->victim_hits + s->read_misses + s->write_misses;
+    fprintf(out, "%-5s    %-6s  %7u  %10llu   %8.4f\n", level->name, victim_names[level->victim],
+            level->victim_entries, s->victim_hits, misses ? (double)s->victim_hits / misses : 0.0);
+  }
+}
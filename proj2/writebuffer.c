@@ -0,0 +1,245 @@
+#include "tips.h"
+#include "util.h"
+
+/*
+  Write buffer in front of DRAM. Writes that reach DRAM wait here, so a
+  write-through cache doesn't stall on every store: a write to a block
+  that has an entry merges into it, and otherwise takes a new entry,
+  first retiring the oldest if the buffer is full (a stall).
+
+  DRAM can take one entry every drain_interval accesses to the
+  hierarchy. EAGER retires the oldest whenever it can, LAZY only while
+  the buffer is at least half full, leaving writes longer to coalesce.
+
+  Reads from DRAM see the words buffered for them, and a read the buffer
+  holds entirely doesn't go to DRAM at all. Entries hold whole words, as
+  nothing smaller reaches DRAM, and are written in the fewest aligned
+  transfers covering the words they hold; bytes_in less the bytes written
+  is the DRAM write traffic saved.
+*/
+
+static char* drain_names[] = { "eager", "lazy" };
+
+/* The drain policy called name, or -1 */
+int parse_drain_policy(const char* name)
+{
+  int i;
+
+  for(i = 0; i <= DRAIN_LAZY; i++)
+    if(strcmp(name, drain_names[i]) == 0)
+      return i;
+  return -1;
+}
+
+/* Write a description of h's write buffer into buffer */
+void describe_write_buffer(cacheHierarchy* h, char* buffer)
+{
+  writeBuffer* wb = &h->write_buffer;
+
+  if(wb->entries == 0)
+    strcpy(buffer, "none");
+  else
+    sprintf(buffer, "%u entries of %u bytes, %s drain every %u accesses", wb->entries, wb->block_size,
+            drain_names[wb->drain], wb->drain_interval);
+}
+
+/*
+  Allocate h's write buffer, freeing the old one. Its entries are as
+  large as the blocks of the lowest level, the largest written to DRAM.
+*/
+void allocate_write_buffer(cacheHierarchy* h)
+{
+  writeBuffer* wb = &h->write_buffer;
+  cacheLevel* level = h->first[DATA_ACCESS];
+
+  free_write_buffer(h);
+  while(level != NULL && level->next != NULL)
+    level = level->next;
+  wb->block_size = level != NULL ? level->block_size : sizeof(word);
+  if(wb->entries == 0)
+    return;
+
+  wb->entry = calloc(wb->entries, sizeof(writeBufferEntry));
+  if(wb->entry == NULL)
+  {
+    fprintf(stderr, "Unable to allocate a %u entry write buffer\n", wb->entries);
+    exit(1);
+  }
+}
+
+/* The bits of n words from word first */
+static unsigned int word_mask(unsigned int first, unsigned int n)
+{
+  return (n >= 32 ? ~0u : (1u << n) - 1) << first;
+}
+
+/* Write the oldest entry to DRAM and remove it, returning the cycles that takes */
+static unsigned int retire(cacheHierarchy* h)
+{
+  writeBuffer* wb = &h->write_buffer;
+  writeBufferEntry* e = &wb->entry[0];
+  unsigned int words = wb->block_size / sizeof(word);
+  unsigned int i = 0;
+  unsigned int n;
+  unsigned int cycles = 0;
+
+  while(i < words)
+  {
+    if(!(e->mask & 1u << i))
+    {
+      i++;
+      continue;
+    }
+    /* Double the transfer while it stays aligned and every word is held */
+    for(n = 1; i % (2 * n) == 0 && i + 2 * n <= words &&
+          (e->mask & word_mask(i, 2 * n)) == word_mask(i, 2 * n); n *= 2)
+      ;
+    if(!h->tags_only)
+      accessDRAM(e->addr + i * sizeof(word), e->data + i * sizeof(word), (TransferUnit)uint_log2(n * sizeof(word)), WRITE);
+    h->dram_writes += n * sizeof(word);
+    h->dram_bytes[h->type][WRITE] += n * sizeof(word);
+    cycles += dram_cycles(h, n * sizeof(word));
+    i += n;
+  }
+
+  wb->stats.retired++;
+  wb->count--;
+  memmove(wb->entry, wb->entry + 1, sizeof(writeBufferEntry) * wb->count);
+  return cycles;
+}
+
+/*
+  Write every entry to DRAM and empty the buffer, so flushing the caches
+  loses no stores. A tags-only run's entries hold no data and are simply
+  discarded.
+*/
+void flush_write_buffer(cacheHierarchy* h)
+{
+  while(h->write_buffer.count != 0 && !h->tags_only)
+    retire(h);
+  h->write_buffer.count = 0;
+  h->write_buffer.ticks = 0;
+}
+
+/* Free h's write buffer, first writing its entries to DRAM */
+void free_write_buffer(cacheHierarchy* h)
+{
+  flush_write_buffer(h);
+  free(h->write_buffer.entry);
+  h->write_buffer.entry = NULL;
+}
+
+/* Buffer size bytes written to DRAM at addr */
+void buffer_write(cacheHierarchy* h, address addr, byte* data, unsigned int size)
+{
+  writeBuffer* wb = &h->write_buffer;
+  address block = addr & ~(wb->block_size - 1);
+  writeBufferEntry* e = NULL;
+  unsigned int i;
+
+  if(size > wb->block_size)
+  {
+    for(i = 0; i < size; i += wb->block_size)
+      buffer_write(h, addr + i, data + i, wb->block_size);
+    return;
+  }
+
+  wb->stats.writes++;
+  wb->stats.bytes_in += size;
+  for(i = 0; i < wb->count && e == NULL; i++)
+    if(wb->entry[i].addr == block)
+      e = &wb->entry[i];
+
+  if(e != NULL)
+    wb->stats.coalesced++;
+  else
+  {
+    if(wb->count == wb->entries)
+    {
+      /* The write waits for the oldest entry to go */
+      wb->stats.stalls++;
+      h->latency += retire(h);
+    }
+    e = &wb->entry[wb->count++];
+    e->addr = block;
+    e->mask = 0;
+  }
+
+  if(!h->tags_only)
+    memcpy(e->data + (addr - block), data, size);
+  e->mask |= word_mask((addr - block) / sizeof(word), size / sizeof(word));
+}
+
+/* Nonzero if the buffer holds every word of the size bytes at addr */
+int buffer_holds(cacheHierarchy* h, address addr, unsigned int size)
+{
+  writeBuffer* wb = &h->write_buffer;
+  unsigned int held = 0;
+  unsigned int i;
+  unsigned int w;
+  address a;
+
+  for(i = 0; i < wb->count; i++)
+    for(w = 0; w < wb->block_size / sizeof(word); w++)
+    {
+      a = wb->entry[i].addr + w * sizeof(word);
+      if(a >= addr && a < addr + size && (wb->entry[i].mask & 1u << w))
+        held += sizeof(word);
+    }
+  return held == size;
+}
+
+/* Copy any buffered words of the size bytes at addr over data, just read from DRAM */
+void forward_buffered(cacheHierarchy* h, address addr, byte* data, unsigned int size)
+{
+  writeBuffer* wb = &h->write_buffer;
+  int forwarded = 0;
+  unsigned int i;
+  unsigned int w;
+  address a;
+
+  for(i = 0; i < wb->count; i++)
+    for(w = 0; w < wb->block_size / sizeof(word); w++)
+    {
+      a = wb->entry[i].addr + w * sizeof(word);
+      if(a >= addr && a < addr + size && (wb->entry[i].mask & 1u << w))
+      {
+        if(!h->tags_only)
+          memcpy(data + (a - addr), wb->entry[i].data + w * sizeof(word), sizeof(word));
+        forwarded = 1;
+      }
+    }
+  wb->stats.forwards += forwarded;
+}
+
+/* Advance the buffer by one access to the hierarchy, retiring an entry if DRAM can take it */
+void tick_write_buffer(cacheHierarchy* h)
+{
+  writeBuffer* wb = &h->write_buffer;
+
+  if(wb->entries == 0 || ++wb->ticks < wb->drain_interval)
+    return;
+  wb->ticks = 0;
+  if(wb->count != 0 && (wb->drain == DRAIN_EAGER || 2 * wb->count >= wb->entries))
+    retire(h);
+}
+
+/* Write the buffer's statistics. Bytes still buffered count as written */
+void print_write_buffer_stats(cacheHierarchy* h, FILE* out)
+{
+  writeBuffer* wb = &h->write_buffer;
+  writeBufferStats* s = &wb->stats;
+  long long pending = 0;
+  unsigned int i;
+  unsigned int w;
+
+  if(wb->entries == 0)
+    return;
+  for(i = 0; i < wb->count; i++)
+    for(w = 0; w < wb->block_size / sizeof(word); w++)
+      if(wb->entry[i].mask & 1u << w)
+        pending += sizeof(word);
+  fprintf(out, "Write buffer   Writes  Coalesced   Retired    Stalls  Forwards  Bytes-Saved\n");
+  fprintf(out, "           %10llu %10llu %9llu %9llu %9llu  %11lld\n", s->writes, s->coalesced, s->retired,
+          s->stalls, s->forwards, (long long)s->bytes_in - (long long)h->dram_writes - pending);
+}